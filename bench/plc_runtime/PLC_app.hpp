@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <chrono>
+#include <string>
+#include <map>
+
+
+
+// Stand-in for the PLC runtime header, used by plceditio-scan-bench to run generated
+// programs on the development machine. IO inputs change every PLC_BENCH_INPUT_PERIOD cycles,
+// after PLC_BENCH_CYCLES cycles LoopStart() prints timing as JSON and stops the program.
+
+#ifndef PLC_BENCH_CYCLES
+#define PLC_BENCH_CYCLES 100000
+#endif
+
+#ifndef PLC_BENCH_INPUT_PERIOD
+#define PLC_BENCH_INPUT_PERIOD 1
+#endif
+
+namespace PLC {
+
+    struct IOmoduleData {
+        uint32_t input = 0;
+        uint32_t output = 0;
+    };
+
+    inline IOmoduleData io_module;
+    inline uint64_t cycle = 0;
+    inline std::chrono::steady_clock::time_point start_time;
+
+
+    inline IOmoduleData GetIO(int module = 0){
+        io_module.input = (uint32_t)(cycle / PLC_BENCH_INPUT_PERIOD * 2654435761u);
+        return io_module;
+    }
+
+    inline void SetIO(const IOmoduleData& data, int module = 0){
+        io_module.output = data.output;
+    }
+
+
+    inline bool LoopStart(){
+        if(cycle == 0) start_time = std::chrono::steady_clock::now();
+
+        if(cycle == PLC_BENCH_CYCLES){
+            auto elapsed = std::chrono::steady_clock::now() - start_time;
+            double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+            std::printf("{\"cycles\":%llu,\"ns_per_cycle\":%f,\"output\":%u}\n", 
+                (unsigned long long)cycle, ns / cycle, io_module.output);
+            return false;
+        }
+
+        cycle++;
+        return true;
+    }
+
+    inline void LoopEnd(){}
+
+}
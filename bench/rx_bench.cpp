@@ -0,0 +1,205 @@
+// plceditio-rx-bench - throughput of PLC response receive path (framing and JSON parsing)
+//
+// usage: plceditio-rx-bench [options]
+//   -n <count>        messages in PING and APP_STATUS streams (default: 100000)
+//   -e <count>        CompilationResult entries of one APP_BUILD response (default: 200)
+//   --read <bytes>    bytes delivered by one socket read (default: 65536)
+//   -r <repeat>       repetitions of every measurement (default: 5)
+//   -o <file>         write results to file instead of stdout
+//
+// Every stream of newline terminated responses is fed to JsonFrameReader in reads of the given
+// size, the same way PLCclient receives it. The previous receive path (byte by byte scan feeding
+// stream_parser) is measured on the same streams for comparison.
+// Results are printed as JSON, one entry per stream and reader.
+
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <boost/json.hpp>
+#include "json_frame_reader.hpp"
+
+
+
+struct Stream{
+    std::string name;
+    std::string data;
+    size_t messages = 0;
+};
+
+
+// receive path before JsonFrameReader, kept only for comparison
+class LegacyReader{
+    boost::json::stream_parser json_parser;
+
+public:
+    template<typename OnMessage>
+    void Feed(const char* data, size_t len, OnMessage&& on_message){
+        std::error_code err;
+        size_t start = 0;
+        for(size_t i = 0; i < len; i++){
+            if(data[i] == '\n'){
+                json_parser.write(&data[start], i - start, err);
+                json_parser.finish(err);
+
+                if(json_parser.done()){
+                    auto json = json_parser.release();
+                    on_message(json);
+                }
+                json_parser.reset();
+                start = i;
+            }
+        }
+        json_parser.write(&data[start], len - start, err);
+    }
+};
+
+
+static Stream MakeStream(const std::string& name, size_t count, std::function<boost::json::object(size_t)> message){
+    Stream stream{name};
+    for(size_t i = 0; i < count; i++)
+        stream.data += boost::json::serialize(message(i)) + "\n";
+    stream.messages = count;
+    return stream;
+}
+
+
+static double Elapsed(std::function<void()> func){
+    auto start = std::chrono::steady_clock::now();
+    func();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+
+int main(int argc, char** argv){
+
+    size_t messages = 100000;
+    size_t errors = 200;
+    size_t read_size = 65536;
+    int repeat = 5;
+    std::string out_path;
+
+    // step 1 - parse arguments
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if(arg == "-n" && has_value)            messages = std::max(1LL, std::stoll(argv[++i]));
+        else if(arg == "-e" && has_value)       errors = std::max(0LL, std::stoll(argv[++i]));
+        else if(arg == "--read" && has_value)   read_size = std::max(1LL, std::stoll(argv[++i]));
+        else if(arg == "-r" && has_value)       repeat = std::max(1, std::stoi(argv[++i]));
+        else if(arg == "-o" && has_value)       out_path = argv[++i];
+        else{
+            std::cerr << "unknown argument: " << arg << "\n";
+            return 2;
+        }
+    }
+
+    // step 2 - response streams as PLC runtime sends them
+    std::vector<Stream> streams;
+
+    streams.push_back(MakeStream("PING", messages, [](size_t){
+        boost::json::object msg;
+        msg["Cmd"] = "PING";
+        return msg;
+    }));
+
+    streams.push_back(MakeStream("APP_STATUS", messages, [](size_t i){
+        boost::json::object msg;
+        msg["Cmd"] = "APP_STATUS";
+        msg["Result"] = "OK";
+        msg["Status"] = i % 2 ? "RUNNING" : "STOPPED";
+        return msg;
+    }));
+
+    streams.push_back(MakeStream("APP_BUILD", std::max<size_t>(10, messages / 100), [errors](size_t i){
+        boost::json::array results;
+        for(size_t e = 0; e < errors; e++){
+            boost::json::object result;
+            result["File"] = "block_" + std::to_string(e) + ".cpp";
+            result["ExitCode"] = 1;
+            result["ErrorMsg"] = "block_" + std::to_string(e) + ".cpp:" + std::to_string(i + e) + ":5: error: 'output0' was not declared in this scope";
+            results.push_back(result);
+        }
+
+        boost::json::object msg;
+        msg["Cmd"] = "APP_BUILD";
+        msg["Result"] = "OK";
+        msg["CompilationResult"] = results;
+        return msg;
+    }));
+
+    // step 3 - measure both readers on every stream
+    boost::json::array results;
+
+    for(const Stream& stream: streams){
+        for(const std::string reader_name: {"JsonFrameReader", "legacy"}){
+
+            std::vector<double> ms;
+            size_t parsed = 0;
+
+            for(int r = 0; r < repeat; r++){
+                parsed = 0;
+                auto on_message = [&](const boost::json::value&){ parsed++; };
+
+                if(reader_name == "legacy"){
+                    LegacyReader reader;
+                    ms.push_back(Elapsed([&](){
+                        for(size_t pos = 0; pos < stream.data.size(); pos += read_size)
+                            reader.Feed(stream.data.data() + pos, std::min(read_size, stream.data.size() - pos), on_message);
+                    }));
+                }else{
+                    JsonFrameReader reader;
+                    ms.push_back(Elapsed([&](){
+                        for(size_t pos = 0; pos < stream.data.size(); pos += read_size)
+                            reader.Feed(stream.data.data() + pos, std::min(read_size, stream.data.size() - pos), on_message, [](JsonFrameReader::Error){});
+                    }));
+                }
+            }
+
+            if(parsed != stream.messages)
+                std::cerr << reader_name << ": " << stream.name << " parsed " << parsed << " of " << stream.messages << " messages\n";
+
+            std::sort(ms.begin(), ms.end());
+            const double median_s = ms[ms.size() / 2] / 1000.0;
+
+            boost::json::object obj;
+            obj["name"] = stream.name;
+            obj["reader"] = reader_name;
+            obj["messages"] = stream.messages;
+            obj["parsed"] = parsed;
+            obj["bytes"] = stream.data.size();
+            obj["repeat"] = repeat;
+            obj["min_ms"] = ms.front();
+            obj["median_ms"] = ms[ms.size() / 2];
+            obj["messages_per_s"] = median_s > 0 ? stream.messages / median_s : 0.0;
+            obj["mb_per_s"] = median_s > 0 ? stream.data.size() / median_s / 1e6 : 0.0;
+            results.push_back(obj);
+        }
+
+        std::cerr << stream.name << " done\n";
+    }
+
+    // step 4 - report
+    boost::json::object report;
+    report["benchmark"] = "rx";
+    report["read_size"] = read_size;
+    report["compilation_errors"] = errors;
+    report["results"] = results;
+
+    std::string json = boost::json::serialize(report);
+
+    if(out_path.empty()){
+        std::cout << json << "\n";
+    }else{
+        std::ofstream out(out_path);
+        out << json << "\n";
+    }
+
+    return 0;
+}
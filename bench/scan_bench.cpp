@@ -0,0 +1,222 @@
+// plceditio-scan-bench - scan time of generated programs in different code generation modes
+//
+// usage: plceditio-scan-bench [options]
+//   -s <dir>          standard block library (default: "std_blocks" next to executable)
+//   -n <list>         comma separated block counts (default: 1000,10000)
+//   -c <ratio>        connections per block (default: 1.5)
+//   -d <depth>        number of layers blocks are spread over (default: 32)
+//   -f <fan-out>      max connections taken from single output (default: 4)
+//   --seed <seed>     generator seed (default: 1)
+//   --cycles <n>      scan cycles measured in every program (default: 100000)
+//   --input-period <n> IO inputs change every <n> cycles (default: 1)
+//   --cxx <command>   compiler used to build generated programs (default: c++)
+//   --flags <flags>   compiler flags (default: "-O2 -std=c++17")
+//   --runtime <dir>   directory with PLC_app.hpp stand-in (default: bench/plc_runtime)
+//   -o <file>         write results to file instead of stdout
+//
+// Every synthetic schematic is generated once, then built with BuildToCPP in every mode,
+// compiled with the host compiler and executed.
+// Results are printed as JSON, one entry per mode and schematic size.
+
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <boost/json.hpp>
+#include "schematic.hpp"
+#include "librarian.hpp"
+#include "schematic_generator.hpp"
+
+#ifndef PLC_BENCH_RUNTIME_DIR
+#define PLC_BENCH_RUNTIME_DIR "plc_runtime"
+#endif
+
+
+
+struct Mode{
+    std::string name;
+    Schematic::CodeOptions options;
+};
+
+
+static std::vector<Mode> Modes(){
+    Mode runtime{"runtime_parameters"};
+
+    Mode constant{"constant_parameters"};
+    constant.options.constant_parameters = true;
+
+    Mode change_driven{"change_driven"};
+    change_driven.options.change_driven = true;
+
+    return {runtime, constant, change_driven};
+}
+
+
+static bool ReadFile(const std::filesystem::path& path, std::string* data){
+    std::ifstream file(path, std::ios::binary);
+    if(!file.is_open()) return false;
+    std::stringstream ss;
+    ss << file.rdbuf();
+    *data = ss.str();
+    return true;
+}
+
+
+int main(int argc, char** argv){
+
+    std::filesystem::path std_path = std::filesystem::path(argv[0]).parent_path() / "std_blocks";
+    std::filesystem::path runtime_path = PLC_BENCH_RUNTIME_DIR;
+    std::vector<int> sizes = {1000, 10000};
+    GeneratorConfig cfg;
+    long long cycles = 100000;
+    long long input_period = 1;
+    std::string cxx = "c++";
+    std::string flags = "-O2 -std=c++17";
+    std::string out_path;
+
+    // step 1 - parse arguments
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if(arg == "-s" && has_value)             std_path = argv[++i];
+        else if(arg == "-c" && has_value)        cfg.connections_per_block = std::stod(argv[++i]);
+        else if(arg == "-d" && has_value)        cfg.depth = std::stoi(argv[++i]);
+        else if(arg == "-f" && has_value)        cfg.fan_out = std::stoi(argv[++i]);
+        else if(arg == "--seed" && has_value)    cfg.seed = std::stoul(argv[++i]);
+        else if(arg == "--cycles" && has_value)  cycles = std::max(1LL, std::stoll(argv[++i]));
+        else if(arg == "--input-period" && has_value) input_period = std::max(1LL, std::stoll(argv[++i]));
+        else if(arg == "--cxx" && has_value)     cxx = argv[++i];
+        else if(arg == "--flags" && has_value)   flags = argv[++i];
+        else if(arg == "--runtime" && has_value) runtime_path = argv[++i];
+        else if(arg == "-o" && has_value)        out_path = argv[++i];
+        else if(arg == "-n" && has_value){
+            sizes.clear();
+            std::string list = argv[++i];
+            size_t pos = 0;
+            while(pos < list.size()){
+                size_t end = list.find(',', pos);
+                if(end == std::string::npos) end = list.size();
+                sizes.push_back(std::stoi(list.substr(pos, end - pos)));
+                pos = end + 1;
+            }
+        }
+        else{
+            std::cerr << "unknown argument: " << arg << "\n";
+            return 2;
+        }
+    }
+
+    if(!std::filesystem::exists(runtime_path / "PLC_app.hpp")){
+        std::cerr << "PLC_app.hpp not found in " << runtime_path.string() << "\n";
+        return 1;
+    }
+
+    // step 2 - load library
+    Librarian library;
+    library.SetProjectPath("");
+    library.SetStdLibPath(std_path.lexically_normal());
+    library.Scan();
+
+    std::vector<std::shared_ptr<BlockData>> lib_blocks;
+    CollectBlocks(library.GetLib(), &lib_blocks);
+    if(lib_blocks.empty()){
+        std::cerr << "no blocks found in " << std_path.string() << "\n";
+        return 1;
+    }
+
+    const std::filesystem::path work_dir = std::filesystem::temp_directory_path() / "plceditio_scan_bench";
+    std::filesystem::create_directories(work_dir);
+
+    boost::json::array results;
+
+    for(int size: sizes){
+
+        // step 3 - generate schematic
+        cfg.blocks = size;
+        Schematic schematic;
+        GenerateSchematic(&schematic, lib_blocks, cfg);
+        schematic.SortBlocks();
+
+        for(const Mode& mode: Modes()){
+
+            // step 4 - generate and compile program
+            schematic.SetCodeOptions(mode.options);
+            const std::string code = schematic.BuildToCPP();
+
+            const std::filesystem::path source = work_dir / ("scan_" + std::to_string(size) + "_" + mode.name + ".cpp");
+            const std::filesystem::path program = work_dir / ("scan_" + std::to_string(size) + "_" + mode.name + ".exe");
+            const std::filesystem::path output = work_dir / ("scan_" + std::to_string(size) + "_" + mode.name + ".json");
+            std::ofstream(source, std::ios::binary) << code;
+
+            std::string compile = cxx + " " + flags + " -DPLC_BENCH_CYCLES=" + std::to_string(cycles)
+                + " -DPLC_BENCH_INPUT_PERIOD=" + std::to_string(input_period)
+                + " -I\"" + runtime_path.string() + "\" -o \"" + program.string() + "\" \"" + source.string() + "\"";
+
+            auto compile_start = std::chrono::steady_clock::now();
+            if(std::system(compile.c_str()) != 0){
+                std::cerr << "compilation failed: " << compile << "\n";
+                return 1;
+            }
+            double compile_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - compile_start).count();
+
+            // step 5 - run program, it prints its own timing
+            std::string run = "\"" + program.string() + "\" > \"" + output.string() + "\"";
+            std::string run_result;
+            if(std::system(run.c_str()) != 0 || !ReadFile(output, &run_result)){
+                std::cerr << "run failed: " << run << "\n";
+                return 1;
+            }
+
+            boost::json::error_code ec;
+            boost::json::value js = boost::json::parse(run_result, ec);
+            const boost::json::value* ns_per_cycle = (!ec && js.is_object()) ? js.as_object().if_contains("ns_per_cycle") : nullptr;
+            if(!ns_per_cycle){
+                std::cerr << "unexpected output of " << program.string() << ": " << run_result << "\n";
+                return 1;
+            }
+
+            boost::json::object obj;
+            obj["mode"] = mode.name;
+            obj["blocks"] = size;
+            obj["connections"] = schematic.ConnectionCount();
+            obj["cycles"] = cycles;
+            obj["ns_per_cycle"] = *ns_per_cycle;
+            obj["compile_s"] = compile_s;
+            obj["code_bytes"] = code.size();
+            results.push_back(obj);
+
+            std::filesystem::remove(source);
+            std::filesystem::remove(program);
+            std::filesystem::remove(output);
+
+            std::cerr << size << " blocks, " << mode.name << " done\n";
+        }
+    }
+
+    // step 6 - report
+    boost::json::object report;
+    report["benchmark"] = "scan";
+    report["seed"] = cfg.seed;
+    report["connections_per_block"] = cfg.connections_per_block;
+    report["depth"] = cfg.depth;
+    report["fan_out"] = cfg.fan_out;
+    report["compiler"] = cxx + " " + flags;
+    report["results"] = results;
+
+    std::string json = boost::json::serialize(report);
+
+    if(out_path.empty()){
+        std::cout << json << "\n";
+    }else{
+        std::ofstream out(out_path);
+        out << json << "\n";
+    }
+
+    return 0;
+}
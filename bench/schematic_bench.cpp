@@ -0,0 +1,250 @@
+// plceditio-bench - timing of schematic core paths on synthetic schematics
+//
+// usage: plceditio-bench [options]
+//   -s <dir>          standard block library (default: "std_blocks" next to executable)
+//   -n <list>         comma separated block counts (default: 1000,10000,100000)
+//   -c <ratio>        connections per block (default: 1.5)
+//   -d <depth>        number of layers blocks are spread over (default: 32)
+//   -f <fan-out>      max connections taken from single output (default: 4)
+//   -r <repeat>       repetitions of every measurement (default: 5)
+//   --seed <seed>     generator seed (default: 1)
+//   -o <file>         write results to file instead of stdout
+//
+// Results are printed as JSON, one entry per measured function and schematic size.
+// Before measuring, execution order index is checked after manual reorder followed by delete.
+
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <boost/json.hpp>
+#include "schematic.hpp"
+#include "librarian.hpp"
+#include "schematic_generator.hpp"
+
+
+
+struct Measurement{
+    std::string name;
+    std::vector<double> ms;
+};
+
+
+static double Elapsed(std::function<void()> func){
+    auto start = std::chrono::steady_clock::now();
+    func();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+
+// blocks reordered in Execution Order window and then deleted must leave consistent order
+static bool CheckManualOrder(const std::vector<std::shared_ptr<BlockData>>& lib_blocks){
+    GeneratorConfig cfg;
+    cfg.blocks = 64;
+
+    for(bool incremental: {true, false}){
+        Schematic schematic;
+        GenerateSchematic(&schematic, lib_blocks, cfg);
+        schematic.SetIncrementalOrder(true);
+        schematic.SortBlocks();
+        schematic.SetIncrementalOrder(incremental);
+
+        auto Remove = [&](int removed, int kept) -> bool{
+            const size_t count = schematic.BlockCount();
+            schematic.RemoveBlock(removed);
+
+            bool kept_found = false;
+            for(auto& block: schematic.blocks){
+                if(block->id == removed) return false;
+                if(block->id == kept) kept_found = true;
+            }
+            return kept_found && schematic.BlockCount() == count - 1 && !schematic.FindBlock(removed) && schematic.FindBlock(kept);
+        };
+
+        // step 1 - swap first two blocks, delete the first one
+        auto a = schematic.blocks.begin();
+        auto b = std::next(a);
+        int a_id = (*a)->id, b_id = (*b)->id;
+        schematic.SwapBlocks(a, b);
+        if(!Remove(a_id, b_id)){
+            std::cerr << "order check failed: swap and remove, incremental " << incremental << "\n";
+            return false;
+        }
+
+        // step 2 - move first block behind the third one, delete it
+        a = schematic.blocks.begin();
+        a_id = (*a)->id;
+        b_id = (*std::next(a))->id;
+        schematic.MoveBlock(a, std::next(a, 2));
+        if(!Remove(a_id, b_id)){
+            std::cerr << "order check failed: move and remove, incremental " << incremental << "\n";
+            return false;
+        }
+
+        // step 3 - order is still updated after deletion
+        schematic.SetIncrementalOrder(true);
+        schematic.UpdateOrder();
+        for(auto& block: schematic.blocks){
+            if(schematic.FindBlock(block->id) != block){
+                std::cerr << "order check failed: update after remove, incremental " << incremental << "\n";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+int main(int argc, char** argv){
+
+    std::filesystem::path std_path = std::filesystem::path(argv[0]).parent_path() / "std_blocks";
+    std::vector<int> sizes = {1000, 10000, 100000};
+    GeneratorConfig cfg;
+    int repeat = 5;
+    std::string out_path;
+
+    // step 1 - parse arguments
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if(arg == "-s" && has_value)            std_path = argv[++i];
+        else if(arg == "-c" && has_value)       cfg.connections_per_block = std::stod(argv[++i]);
+        else if(arg == "-d" && has_value)       cfg.depth = std::stoi(argv[++i]);
+        else if(arg == "-f" && has_value)       cfg.fan_out = std::stoi(argv[++i]);
+        else if(arg == "-r" && has_value)       repeat = std::max(1, std::stoi(argv[++i]));
+        else if(arg == "--seed" && has_value)   cfg.seed = std::stoul(argv[++i]);
+        else if(arg == "-o" && has_value)       out_path = argv[++i];
+        else if(arg == "-n" && has_value){
+            sizes.clear();
+            std::string list = argv[++i];
+            size_t pos = 0;
+            while(pos < list.size()){
+                size_t end = list.find(',', pos);
+                if(end == std::string::npos) end = list.size();
+                sizes.push_back(std::stoi(list.substr(pos, end - pos)));
+                pos = end + 1;
+            }
+        }
+        else{
+            std::cerr << "unknown argument: " << arg << "\n";
+            return 2;
+        }
+    }
+
+    // step 2 - load library
+    Librarian library;
+    library.SetProjectPath("");
+    library.SetStdLibPath(std_path.lexically_normal());
+    library.Scan();
+
+    std::vector<std::shared_ptr<BlockData>> lib_blocks;
+    CollectBlocks(library.GetLib(), &lib_blocks);
+    if(lib_blocks.empty()){
+        std::cerr << "no blocks found in " << std_path.string() << "\n";
+        return 1;
+    }
+
+    if(!CheckManualOrder(lib_blocks)) return 1;
+
+    boost::json::array results;
+
+    for(int size: sizes){
+
+        // step 3 - generate schematic and store it in temporary file
+        cfg.blocks = size;
+        std::filesystem::path file = std::filesystem::temp_directory_path() / ("plceditio_bench_" + std::to_string(size) + ".schematic");
+        std::filesystem::path file_binary = file;
+        file_binary.replace_extension(SchematicBinary::EXTENSION);
+
+        int64_t connection_count = 0;
+        {
+            Schematic generated;
+            GenerateSchematic(&generated, lib_blocks, cfg);
+            connection_count = generated.ConnectionCount();
+
+            for(auto& p: {file, file_binary}){
+                Schematic::Error err = generated.Save(p);
+                if(err != Schematic::Error::OK){
+                    std::cerr << p.string() << ": " << Schematic::ErrorToStr(err) << "\n";
+                    return 1;
+                }
+            }
+        }
+
+        // step 4 - measure every stage of the pipeline on fresh schematic
+        std::vector<Measurement> measurements = {
+            {"Read"}, {"LinkWithLibrary"}, {"RemoveInvalidElements"}, {"SortBlocks"}, {"BuildToCPP"}, {"Serialize"},
+            {"ReadBinary"}, {"SerializeBinary"}
+        };
+        size_t code_size = 0;
+
+        for(int r = 0; r < repeat; r++){
+            Schematic schematic;
+            std::string code;
+            std::string data;
+
+            measurements[0].ms.push_back(Elapsed([&](){ schematic.Read(file); }));
+            measurements[1].ms.push_back(Elapsed([&](){ schematic.LinkWithLibrary(&library); }));
+            measurements[2].ms.push_back(Elapsed([&](){ schematic.RemoveInvalidElements(); }));
+            measurements[3].ms.push_back(Elapsed([&](){ schematic.SortBlocks(); }));
+            measurements[4].ms.push_back(Elapsed([&](){ code = schematic.BuildToCPP(); }));
+            measurements[5].ms.push_back(Elapsed([&](){ schematic.Serialize(&data); }));
+
+            Schematic schematic_binary;
+            measurements[6].ms.push_back(Elapsed([&](){ schematic_binary.Read(file_binary); }));
+            measurements[7].ms.push_back(Elapsed([&](){ schematic_binary.SerializeBinary(&data); }));
+
+            code_size = code.size();
+        }
+
+        std::filesystem::remove(file);
+        std::filesystem::remove(file_binary);
+
+        for(auto& m: measurements){
+            std::sort(m.ms.begin(), m.ms.end());
+            double sum = 0;
+            for(double v: m.ms) sum += v;
+
+            boost::json::object obj;
+            obj["name"] = m.name;
+            obj["blocks"] = size;
+            obj["connections"] = connection_count;
+            obj["repeat"] = repeat;
+            obj["min_ms"] = m.ms.front();
+            obj["median_ms"] = m.ms[m.ms.size() / 2];
+            obj["mean_ms"] = sum / m.ms.size();
+            obj["max_ms"] = m.ms.back();
+            if(m.name == "BuildToCPP") obj["output_bytes"] = code_size;
+            results.push_back(obj);
+        }
+
+        std::cerr << size << " blocks done\n";
+    }
+
+    // step 5 - report
+    boost::json::object report;
+    report["benchmark"] = "schematic";
+    report["seed"] = cfg.seed;
+    report["connections_per_block"] = cfg.connections_per_block;
+    report["depth"] = cfg.depth;
+    report["fan_out"] = cfg.fan_out;
+    report["results"] = results;
+
+    std::string json = boost::json::serialize(report);
+
+    if(out_path.empty()){
+        std::cout << json << "\n";
+    }else{
+        std::ofstream out(out_path);
+        out << json << "\n";
+    }
+
+    return 0;
+}
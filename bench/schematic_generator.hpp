@@ -0,0 +1,94 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <random>
+#include <algorithm>
+#include "schematic.hpp"
+#include "librarian.hpp"
+
+
+
+// synthetic schematics for benchmarks
+
+struct GeneratorConfig{
+    int blocks = 1000;
+    double connections_per_block = 1.5;
+    int depth = 32;
+    int fan_out = 4;
+    uint32_t seed = 1;
+    std::vector<std::string> exclude;   // library blocks with full name starting with any of these are not used
+};
+
+
+inline void CollectBlocks(Librarian::Library& lib, std::vector<std::shared_ptr<BlockData>>* result){
+    for(auto& b: lib.blocks) result->push_back(b);
+    for(auto& sub: lib.sub_libraries) CollectBlocks(sub, result);
+}
+
+
+// Blocks are spread over 'depth' layers. Every connection goes from an output of block in
+// some earlier layer to a free input of block in later layer, so the schematic is acyclic
+// and the longest path is close to 'depth'.
+inline void GenerateSchematic(Schematic* schematic, const std::vector<std::shared_ptr<BlockData>>& library, const GeneratorConfig& cfg){
+
+    std::mt19937 rng(cfg.seed);
+
+    std::vector<std::shared_ptr<BlockData>> sources;  // blocks without inputs
+    std::vector<std::shared_ptr<BlockData>> others;   // blocks with inputs
+    for(auto& b: library){
+        if(b->Outputs().empty() && b->Inputs().empty()) continue;
+
+        bool excluded = false;
+        for(const auto& prefix: cfg.exclude)
+            if(b->FullName().compare(0, prefix.size(), prefix) == 0) excluded = true;
+        if(excluded) continue;
+
+        (b->Inputs().empty() ? sources : others).push_back(b);
+    }
+    if(others.empty()) others = sources;
+    if(sources.empty()) sources = others;
+
+    const int layers = std::max(1, std::min(cfg.depth, cfg.blocks));
+    const int per_layer = std::max(1, cfg.blocks / layers);
+
+    struct Node{ int id; int layer; int inputs; int outputs; };
+    std::vector<Node> nodes;
+    nodes.reserve(cfg.blocks);
+
+    // step 1 - blocks
+    for(int i = 0; i < cfg.blocks; i++){
+        int layer = std::min(i / per_layer, layers - 1);
+        auto& pool = layer == 0 ? sources : others;
+        auto lib_block = pool[rng() % pool.size()];
+
+        auto block = schematic->CreateBlock(lib_block, (layer * 300), (i % per_layer) * 150);
+        block->parameters = lib_block->SetupParameterMemoryTypes();
+        nodes.push_back({block->id, layer, (int)lib_block->Inputs().size(), (int)lib_block->Outputs().size()});
+    }
+
+    // first block of every layer, used to pick source from earlier layers
+    std::vector<int> layer_begin(layers + 1, (int)nodes.size());
+    for(int i = (int)nodes.size() - 1; i >= 0; i--) layer_begin[nodes[i].layer] = i;
+
+    // step 2 - connections
+    std::vector<int> fan_out(nodes.size(), 0);
+    const int64_t connections = (int64_t)(cfg.blocks * cfg.connections_per_block);
+    int64_t created = 0;
+
+    for(int64_t attempt = 0; attempt < connections * 4 && created < connections; attempt++){
+        int dst = rng() % nodes.size();
+        if(nodes[dst].layer == 0 || nodes[dst].inputs == 0) continue;
+
+        int src = rng() % layer_begin[nodes[dst].layer];
+        if(nodes[src].outputs == 0 || fan_out[src] >= cfg.fan_out) continue;
+
+        int src_pin = rng() % nodes[src].outputs;
+        int dst_pin = rng() % nodes[dst].inputs;
+
+        if(schematic->CreateConnection(nodes[src].id, src_pin, nodes[dst].id, dst_pin)){
+            fan_out[src]++;
+            created++;
+        }
+    }
+}
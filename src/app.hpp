@@ -16,6 +16,7 @@
 #include "code_uploader.hpp"
 #include "status_checker.hpp"
 #include "exec_order.hpp"
+#include "build_config.hpp"
 
 
 class App{
@@ -63,44 +64,9 @@ public:
     int code_compilation_errors_count = 0;
 
 
-    struct AppBuildConfig{
-        std::vector<std::string> FilesConst()        { return {"file1.cpp"}; }
-        std::vector<std::string> IncludesConst()     { return {}; }
-        std::vector<std::string> C_CppFlagsConst() { return {"-Wall"}; }
-        std::vector<std::string> LdFlagsConst()    { return {"-Wall"}; }
-
-        std::vector<std::string> files;
-        std::vector<std::string> includes;
-        std::vector<std::string> c_cpp_flags;
-        std::vector<std::string> ld_flags;
-
-        std::string ToString(){
-            boost::json::object obj;
-
-            auto ToJsonArray = 
-                [](std::vector<std::string>& flags, std::vector<std::string> const_flags)->boost::json::array
-                {
-                    boost::json::array arr;
-                    for(std::string& str: const_flags)
-                        arr.push_back(boost::json::string(str));
-                    
-                    for(std::string& str: flags)
-                        arr.push_back(boost::json::string(str));
-
-                    return arr;
-                };
-            
-            obj["Files"] = ToJsonArray(files, FilesConst());
-            obj["Includes"] = ToJsonArray(includes, IncludesConst());
-            obj["CPP_flags"] = ToJsonArray(c_cpp_flags, C_CppFlagsConst());
-            obj["C_flags"] = ToJsonArray(c_cpp_flags, C_CppFlagsConst());
-            obj["LD_flags"] = ToJsonArray(ld_flags, LdFlagsConst());
-
-            return boost::json::serialize(obj);
-        }
-    };
-
     AppBuildConfig app_build_config;
+    bool binary_upload = true;
+    bool compressed_upload = true;
     std::string produced_cpp_code;
     std::string produced_cpp_code_save_path;
     float produced_cpp_code_viewsize_y;
@@ -135,6 +101,17 @@ public:
         event_log.Show(true);
         PLC_connection_log.Show(true);
 
+        // feedback loops and partitioning for parallel execution with options from build config
+        execution_order.OnAnalyze(
+            [this]()
+            {
+                if(execution_order.GetCalculationMethod() != ExecutionOrderWindow::CalculationMethod::AutoAnyChange){
+                    mainSchematic.FindFeedbackLoops();
+                }
+                ApplyCodeOptions();
+                mainSchematic.AnalyzeCode();
+            });
+
         // update selected blocks in windows
         execution_order.OnSelectBlock(
             [this](std::vector<int> IDS)
@@ -146,8 +123,9 @@ public:
         schematic_editor.OnUpdateEvent(
             [this](){
                 // update execution order on every change in schematic
+                // other modes don't touch whole graph on edit, loops are found on Analyze and compile
                 if(execution_order.GetCalculationMethod() == ExecutionOrderWindow::CalculationMethod::AutoAnyChange){
-                    mainSchematic.SortBlocks();
+                    mainSchematic.UpdateOrder();
                 }
             });
           
@@ -461,6 +439,32 @@ private:
         mainSchematic.RemoveInvalidElements();
         schematic_editor.SetSchematic(&mainSchematic);
         schematic_editor.SetLibrary(&library1);
+
+        if(execution_order.GetCalculationMethod() == ExecutionOrderWindow::CalculationMethod::AutoAnyChange){
+            mainSchematic.UpdateOrder();
+        }
+    }
+
+
+    // calculate execution order before producing code
+    void UpdateExecutionOrder(){
+        switch(execution_order.GetCalculationMethod()){
+        case ExecutionOrderWindow::CalculationMethod::AutoAnyChange:   mainSchematic.UpdateOrder(); break; // order is already up to date
+        case ExecutionOrderWindow::CalculationMethod::AutoCompileOnly: mainSchematic.SortBlocks();  break;
+        case ExecutionOrderWindow::CalculationMethod::Manual:          mainSchematic.FindFeedbackLoops(); break; // order is kept, loops are only reported
+        }
+    }
+
+    // code generation modes selected in build config window
+    void ApplyCodeOptions(){
+        Schematic::CodeOptions options;
+        options.signal_table = app_build_config.signal_table;
+        options.optimize = app_build_config.optimize;
+        options.constant_parameters = app_build_config.constant_parameters;
+        options.packed_logic = app_build_config.packed_logic;
+        options.workers = app_build_config.workers;
+        options.change_driven = app_build_config.change_driven;
+        mainSchematic.SetCodeOptions(options);
     }
 
 
@@ -612,15 +616,47 @@ private:
 
             ImGui::BeginDisabled(uploading_code);
 
+            if(ImGui::Checkbox("Binary upload", &binary_upload))
+                code_uploader.SetBinaryTransfer(binary_upload);
+            if(ImGui::IsItemHovered())
+                ImGui::SetTooltip("Files are sent in chunks with checksum, interrupted upload continues where it stopped.\nPLC runtime which doesn't support it gets files as hex text.");
+
+            if(ImGui::Checkbox("Compressed upload", &compressed_upload))
+                code_uploader.SetCompression(compressed_upload);
+            if(ImGui::IsItemHovered())
+                ImGui::SetTooltip("Files are deflate compressed when PLC runtime accepts it.");
+
             ImVec2 button_size = ImVec2(ImGui::GetWindowWidth(), 0);
             if (ImGui::Button("Upload and Compile", button_size)){
-                if(execution_order.GetCalculationMethod() != ExecutionOrderWindow::CalculationMethod::Manual){
-                    mainSchematic.SortBlocks();
+                UpdateExecutionOrder();
+                ApplyCodeOptions();
+                app_build_config.generated_files.clear();
+                code_uploader.ClearFlags();
+
+                if(app_build_config.split_files){
+                    std::vector<CodeFile> files;
+                    Schematic::Error err = mainSchematic.BuildToCPPFiles(&files);
+
+                    produced_cpp_code.clear();
+                    for(const CodeFile& file: files)
+                        produced_cpp_code += "//////// " + file.name + " ////////\n\n" + file.code + "\n";
+
+                    if(err == Schematic::Error::OK){
+                        app_build_config.SetGeneratedFiles(files);
+                        code_uploader.UploadAndBuild(std::move(files), app_build_config.ToString());
+                    }else{
+                        event_log.PushBack(DebugLogger::Priority::_ERROR, std::string("Cannot generate code: ") + Schematic::ErrorToStr(err));
+                    }
+                }else{
+                    produced_cpp_code = mainSchematic.BuildToCPP();
+                    code_uploader.UploadAndBuild(produced_cpp_code, app_build_config.ToString());
                 }
-                produced_cpp_code = mainSchematic.BuildToCPP();
 
-                code_uploader.ClearFlags();
-                code_uploader.UploadAndBuild(produced_cpp_code, app_build_config.ToString());
+                if(app_build_config.optimize || app_build_config.packed_logic || app_build_config.workers > 1 || app_build_config.change_driven || mainSchematic.IsMultiTask())
+                    event_log.PushBack(DebugLogger::Priority::_INFO, "Code optimization:\n" + mainSchematic.GetCodeReport().ToString());
+
+                for(int id: mainSchematic.GetCodeReport().unwritten_memory_reads)
+                    event_log.PushBack(DebugLogger::Priority::_WARNING, "Block " + std::to_string(id) + " reads memory address which is never written");
 
                 produced_cpp_code_viewsize_y = ImGui::CalcTextSize( (produced_cpp_code+"\nX\nX").c_str() ).y;
             }
@@ -676,6 +712,11 @@ private:
             ShowStepStatus(code_uploader.GetFlagStopApp(), code_uploader.GetMsgAppStop(), "Stop App");
             ShowStepStatus(code_uploader.GetFlagCodeUpload(), code_uploader.GetMsgCodeUpload(), "Upload code");
             ShowStepStatus(code_uploader.GetFlagConfigUpload(), code_uploader.GetMsgConfigUpload(), "Upload config");
+            if(code_uploader.GetFlagCodeUpload() == CodeUploader::Status::_WAIT || code_uploader.GetFlagConfigUpload() == CodeUploader::Status::_WAIT)
+                ImGui::ProgressBar(code_uploader.GetUploadProgress());
+            std::string compression_report = code_uploader.GetCompressionReport();
+            if(!compression_report.empty())
+                ImGui::Text("Compression %s", compression_report.c_str());
             ShowStepStatus(code_uploader.GetFlagCodeCompilation(), code_uploader.GetMsgCodeCompilation(), "Compile");
             ImGui::Indent();
         
@@ -748,9 +789,8 @@ private:
         if (ImGui::Begin("C++ code", &show_produced_cpp_code_dialog)) {
 
             if(ImGui::Button("Rebuild code", ImVec2(ImGui::GetWindowWidth()/2,0))){
-                if(execution_order.GetCalculationMethod() != ExecutionOrderWindow::CalculationMethod::Manual){
-                    mainSchematic.SortBlocks();
-                }
+                UpdateExecutionOrder();
+                ApplyCodeOptions();
                 produced_cpp_code = mainSchematic.BuildToCPP();
                 produced_cpp_code_viewsize_y = ImGui::CalcTextSize( (produced_cpp_code+"\nX\nX").c_str() ).y;
             }
@@ -953,6 +993,34 @@ private:
                 ImGui::Unindent();
             };
 
+            ImGui::Checkbox("Separate file per block type", &app_build_config.split_files);
+            if(ImGui::IsItemHovered())
+                ImGui::SetTooltip("Generated code is split into one file per block type,\nso PLC can compile them in parallel and reuse unchanged object files.");
+
+            ImGui::Checkbox("Optimize", &app_build_config.optimize);
+            if(ImGui::IsItemHovered())
+                ImGui::SetTooltip("Unused pure blocks are removed and constant logic is folded.\nReport is written to event log.");
+
+            ImGui::Checkbox("Constant parameters", &app_build_config.constant_parameters);
+            if(ImGui::IsItemHovered())
+                ImGui::SetTooltip("bool/int64_t/double parameters become compile time constants of templated block classes,\nso compiler can specialize every block instance. Changing a parameter requires rebuild.");
+
+            ImGui::Checkbox("Packed logic", &app_build_config.packed_logic);
+            if(ImGui::IsItemHovered())
+                ImGui::SetTooltip("Connected and/or/not/RS/D blocks are evaluated as bitwise operations on uint64_t words,\nup to 64 blocks of the same kind per instruction. Block outputs keep one bit each in 'logic_N' arrays.");
+
+            ImGui::SliderInt("Workers", &app_build_config.workers, 1, 16);
+            if(ImGui::IsItemHovered())
+                ImGui::SetTooltip("Independent parts of program are updated by pool of threads.\nPartitioning and expected speedup are shown in Execution Order window;\nsmall programs stay serial.");
+
+            ImGui::Checkbox("Change-driven", &app_build_config.change_driven);
+            if(ImGui::IsItemHovered())
+                ImGui::SetTooltip("Pure blocks are updated only when some of their inputs changed since their last update,\nIO, memory and time blocks run every cycle. Fast for large programs with mostly static signals.\nProgram runs on one thread, Workers are ignored.");
+
+            ImGui::Checkbox("Signal table", &app_build_config.signal_table);
+            if(ImGui::IsItemHovered())
+                ImGui::SetTooltip("Block outputs are stored in one table ordered by execution order.\nUnconnected inputs read a constant default value instead of nullptr.");
+
             if(ImGui::TreeNode("CPP Files")){
                 FlagsEdit(app_build_config.files, app_build_config.FilesConst());
                 ImGui::TreePop();
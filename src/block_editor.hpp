@@ -331,6 +331,12 @@ private:
             ImGui::BeginDisabled(is_std_block);
                 if(ImGui::InputText("Name", &title))no_saved = true;
                 block_copy.SetTitle(title);
+
+                bool pure = block_copy.IsPure();
+                if(ImGui::Checkbox("Pure", &pure)) no_saved = true;
+                block_copy.SetPure(pure);
+                if(ImGui::IsItemHovered())
+                    ImGui::SetTooltip("update() has no side effects (IO, memory, time)\nand outputs depend only on inputs, parameters and block state.\nUpdate with unchanged inputs must not change outputs.\nUnused pure blocks are removed from generated code,\nin change-driven mode pure blocks are updated only when inputs change.");
             ImGui::EndDisabled();
 
 
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <boost/json.hpp>
+#include "code_writer.hpp"
+
+
+
+// content of "build.conf" file uploaded next to generated code
+struct AppBuildConfig{
+    std::vector<std::string> FilesConst()        { return {"file1.cpp"}; }
+    std::vector<std::string> IncludesConst()     { return {}; }
+    std::vector<std::string> C_CppFlagsConst() { return {"-Wall"}; }
+    std::vector<std::string> LdFlagsConst()    { return {"-Wall"}; }
+
+    std::vector<std::string> files;
+    std::vector<std::string> includes;
+    std::vector<std::string> c_cpp_flags;
+    std::vector<std::string> ld_flags;
+
+    bool split_files = false;                  // one translation unit per block class
+    std::vector<std::string> generated_files;  // extra translation units produced by code generator
+    bool signal_table = false;                 // block outputs in one table, see Schematic::CodeOptions
+    bool optimize = true;                      // dead block removal and constant folding
+    bool constant_parameters = false;          // parameters as template arguments of block classes
+    bool packed_logic = false;                 // boolean networks as bitwise operations on uint64_t
+    int workers = 1;                           // threads of generated program, see Schematic::CodeOptions
+    bool change_driven = false;                // pure blocks updated only when inputs change
+
+    // add translation units from split code generation ("file1.cpp" is always present)
+    void SetGeneratedFiles(const std::vector<CodeFile>& code_files){
+        generated_files.clear();
+        for(const CodeFile& file: code_files){
+            if(file.name != "file1.cpp" && file.name.ends_with(".cpp"))
+                generated_files.push_back(file.name);
+        }
+    }
+
+    std::string ToString(){
+        boost::json::object obj;
+
+        auto ToJsonArray = 
+            [](std::vector<std::string>& flags, std::vector<std::string> const_flags)->boost::json::array
+            {
+                boost::json::array arr;
+                for(std::string& str: const_flags)
+                    arr.push_back(boost::json::string(str));
+                
+                for(std::string& str: flags)
+                    arr.push_back(boost::json::string(str));
+
+                return arr;
+            };
+        
+        std::vector<std::string> files_const = FilesConst();
+        files_const.insert(files_const.end(), generated_files.begin(), generated_files.end());
+
+        obj["Files"] = ToJsonArray(files, files_const);
+        obj["Includes"] = ToJsonArray(includes, IncludesConst());
+        // worker pool of parallel program needs threads
+        std::vector<std::string> c_cpp_const = C_CppFlagsConst();
+        std::vector<std::string> ld_const = LdFlagsConst();
+        if(workers > 1){
+            c_cpp_const.push_back("-pthread");
+            ld_const.push_back("-pthread");
+        }
+
+        obj["CPP_flags"] = ToJsonArray(c_cpp_flags, c_cpp_const);
+        obj["C_flags"] = ToJsonArray(c_cpp_flags, c_cpp_const);
+        obj["LD_flags"] = ToJsonArray(ld_flags, ld_const);
+
+        return boost::json::serialize(obj);
+    }
+};
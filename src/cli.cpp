@@ -0,0 +1,164 @@
+// plceditio-cli - generate PLC program from schematic without GUI
+//
+// usage: plceditio-cli <schematic file> [options]
+//   -o <dir>       output directory (default: current directory)
+//   -s <dir>       standard block library (default: "std_blocks" next to executable)
+//   --split        separate file per block type
+//   --signal-table block outputs in one table ordered by execution order
+//   --no-optimize  keep unused and constant blocks in generated code
+//   --constant-params  bool/int64_t/double parameters as compile time constants
+//   --packed-logic connected boolean blocks evaluated as bitwise operations on uint64_t
+//   --workers <n>  update independent parts of program by <n> threads
+//   --change-driven pure blocks updated only when some of their inputs changed
+//   --no-sort      keep execution order stored in schematic file
+//   --save <file>  also save schematic to <file>; ".schematicb" extension selects binary format
+
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include "schematic.hpp"
+#include "librarian.hpp"
+#include "build_config.hpp"
+
+
+
+static void PrintUsage(){
+    std::cout <<
+        "usage: plceditio-cli <schematic file> [options]\n"
+        "  -o <dir>       output directory (default: current directory)\n"
+        "  -s <dir>       standard block library (default: \"std_blocks\" next to executable)\n"
+        "  --split        separate file per block type\n"
+        "  --signal-table block outputs in one table ordered by execution order\n"
+        "  --no-optimize  keep unused and constant blocks in generated code\n"
+        "  --constant-params  bool/int64_t/double parameters as compile time constants\n"
+        "  --packed-logic connected boolean blocks evaluated as bitwise operations on uint64_t\n"
+        "  --workers <n>  update independent parts of program by <n> threads\n"
+        "  --change-driven pure blocks updated only when some of their inputs changed\n"
+        "  --no-sort      keep execution order stored in schematic file\n"
+        "  --save <file>  also save schematic to <file>; \".schematicb\" extension selects binary format\n";
+}
+
+
+static bool WriteFile(const std::filesystem::path& path, const std::string& data){
+    std::ofstream file(path, std::ios::out | std::ios::binary);
+    if(!file.is_open()) return false;
+    file.write(data.c_str(), data.size());
+    return file.good();
+}
+
+
+int main(int argc, char** argv){
+
+    std::filesystem::path schematic_path;
+    std::filesystem::path out_dir = ".";
+    std::filesystem::path std_path = std::filesystem::path(argv[0]).parent_path() / "std_blocks";
+    bool split_files = false;
+    Schematic::CodeOptions code_options;
+    bool sort_blocks = true;
+    std::filesystem::path save_path;
+
+    // step 1 - parse arguments
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+
+        if(arg == "-o" && i + 1 < argc)       out_dir = argv[++i];
+        else if(arg == "-s" && i + 1 < argc)  std_path = argv[++i];
+        else if(arg == "--split")             split_files = true;
+        else if(arg == "--signal-table")      code_options.signal_table = true;
+        else if(arg == "--no-optimize")       code_options.optimize = false;
+        else if(arg == "--constant-params")   code_options.constant_parameters = true;
+        else if(arg == "--packed-logic")      code_options.packed_logic = true;
+        else if(arg == "--change-driven")     code_options.change_driven = true;
+        else if(arg == "--workers" && i + 1 < argc) code_options.workers = std::max(1, std::atoi(argv[++i]));
+        else if(arg == "--no-sort")           sort_blocks = false;
+        else if(arg == "--save" && i + 1 < argc) save_path = argv[++i];
+        else if(arg == "-h" || arg == "--help"){ PrintUsage(); return 0; }
+        else if(schematic_path.empty() && arg[0] != '-') schematic_path = arg;
+        else{
+            std::cerr << "unknown argument: " << arg << "\n";
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    if(schematic_path.empty()){
+        PrintUsage();
+        return 2;
+    }
+
+    // step 2 - load schematic and link it with library
+    Schematic schematic;
+    Schematic::Error err = schematic.Read(schematic_path);
+    if(err != Schematic::Error::OK){
+        std::cerr << schematic_path.string() << ": " << Schematic::ErrorToStr(err) << "\n";
+        return 1;
+    }
+
+    Librarian library;
+    library.SetProjectPath(schematic.Path().parent_path());
+    library.SetStdLibPath(std_path.lexically_normal());
+    library.Scan();
+
+    schematic.LinkWithLibrary(&library);
+    schematic.RemoveInvalidElements();
+
+    // step 3 - execution order
+    if(sort_blocks)
+        schematic.SortBlocks();
+    else
+        schematic.FindFeedbackLoops();
+
+    for(const auto& loop: schematic.FeedbackLoops()){
+        std::cerr << "warning: feedback loop:";
+        for(int id: loop) std::cerr << " " << id;
+        std::cerr << "\n";
+    }
+
+    // step 4 - generate code and build config
+    std::error_code ec;
+    std::filesystem::create_directories(out_dir, ec);
+
+    AppBuildConfig build_config;
+    build_config.workers = code_options.workers;
+    std::vector<CodeFile> files;
+    schematic.SetCodeOptions(code_options);
+
+    if(split_files){
+        Schematic::Error err = schematic.BuildToCPPFiles(&files);
+        if(err != Schematic::Error::OK){
+            std::cerr << schematic_path.string() << ": " << Schematic::ErrorToStr(err) << "\n";
+            return 1;
+        }
+        build_config.SetGeneratedFiles(files);
+    }else{
+        files.push_back({"file1.cpp", schematic.BuildToCPP()});
+    }
+    files.push_back({"build.conf", build_config.ToString()});
+
+    if(code_options.optimize || code_options.packed_logic || code_options.workers > 1 || code_options.change_driven || schematic.IsMultiTask())
+        std::cout << schematic.GetCodeReport().ToString() << "\n";
+
+    for(const CodeFile& file: files){
+        if(!WriteFile(out_dir / file.name, file.code)){
+            std::cerr << (out_dir / file.name).string() << ": CANNOT_SAVE_FILE\n";
+            return 1;
+        }
+    }
+
+    // step 5 - convert schematic (json <-> binary)
+    if(!save_path.empty()){
+        err = schematic.Save(save_path);
+        if(err != Schematic::Error::OK){
+            std::cerr << save_path.string() << ": " << Schematic::ErrorToStr(err) << "\n";
+            return 1;
+        }
+    }
+
+    std::cout << "generated " << files.size() << " files in " << out_dir.string() << "\n";
+    return 0;
+}
@@ -2,18 +2,32 @@
 
 #include "tcp_client.hpp"
 #include "thread.hpp"
+#include "code_writer.hpp"
 #include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
 
 
 class CodeUploader: public Thread{
 
     PLCclient* plc_client;
     
-    std::string code;
+    std::vector<CodeFile> files;
     std::string config;
 
     static constexpr std::chrono::duration timeout_duration = std::chrono::seconds(5);
     static constexpr std::chrono::duration timeout_compilation_duration = std::chrono::seconds(60);
+    static constexpr std::chrono::duration timeout_capabilities_duration = std::chrono::seconds(1);
+
+    static constexpr size_t window_size = 8 * PLCclient::file_chunk_size;  // bytes sent and not yet acknowledged
+
+    bool binary_transfer = true;
+    bool plc_binary_transfer = true;    // false after PLC ignored FILE_BEGIN, until next upload
+
+    bool compression = true;
+    std::string plc_compression;        // encoding PLC accepts in this upload, empty - plain data
 
 public:
     enum class Status{
@@ -27,10 +41,28 @@ public:
 
     CodeUploader(PLCclient* c): plc_client(c){}
 
+    // files are sent in binary chunks (FILE_BEGIN/FILE_CHUNK/FILE_END), otherwise as hex in one FILE_WRITE;
+    // PLC which doesn't answer FILE_BEGIN gets FILE_WRITE
+    void SetBinaryTransfer(bool binary){
+        if(IsRunning()) return;
+        binary_transfer = binary;
+    }
+
+    // file data is compressed when PLC accepts it (CAPABILITIES handshake before upload)
+    void SetCompression(bool compress){
+        if(IsRunning()) return;
+        compression = compress;
+    }
+
     void UploadAndBuild(std::string _code, std::string _config){
+        UploadAndBuild(std::vector<CodeFile>{{"file1.cpp", std::move(_code)}}, std::move(_config));
+    }
+
+    // upload all files, files must match "Files" field in config
+    void UploadAndBuild(std::vector<CodeFile> _files, std::string _config){
         if(IsRunning()) return;
-        code = _code;
-        config = _config;
+        files = std::move(_files);
+        config = std::move(_config);
         Start();
     }
 
@@ -56,14 +88,20 @@ private:
     std::string config_upload_msg;
     std::string code_compilation_msg;
 
+    uint64_t upload_done = 0;   // bytes of code and config stored by PLC
+    uint64_t upload_total = 0;
+
+    uint64_t compression_original = 0;   // bytes of code and config before and after compression
+    uint64_t compression_sent = 0;
+
 
     void SetFlag(Status* flag,const Status& status){
-        std::scoped_lock(flag_msg_mutex);
+        std::scoped_lock lock(flag_msg_mutex);
         *flag = status;
     }
 
     void SetResponseMsg(std::string* msg, const std::string& response_message ){
-        std::scoped_lock(flag_msg_mutex);
+        std::scoped_lock lock(flag_msg_mutex);
         *msg = response_message;
     }
 
@@ -83,6 +121,22 @@ public:
     std::string GetMsgConfigUpload()   { std::scoped_lock lock(flag_msg_mutex); return config_upload_msg;}
     std::string GetMsgCodeCompilation(){ std::scoped_lock lock(flag_msg_mutex); return code_compilation_msg;}
 
+    // 0.0 - 1.0 of code and config upload
+    float GetUploadProgress(){
+        std::scoped_lock lock(flag_msg_mutex);
+        return upload_total ? (float)upload_done / upload_total : 0.0f;
+    }
+
+    // e.g. "deflate: 812345 -> 96012 bytes (8.46x)", empty when files were sent uncompressed
+    std::string GetCompressionReport(){
+        std::scoped_lock lock(flag_msg_mutex);
+        if(plc_compression.empty() || compression_sent == 0) return "";
+
+        char ratio[32];
+        std::snprintf(ratio, sizeof(ratio), "%.2fx", (double)compression_original / compression_sent);
+        return plc_compression + ": " + std::to_string(compression_original) + " -> " + std::to_string(compression_sent) + " bytes (" + ratio + ")";
+    }
+
     void ClearFlags(){
         if(IsRunning()) return;
 
@@ -95,6 +149,10 @@ public:
         code_upload_msg = "";
         config_upload_msg = "";
         code_compilation_msg = "";
+        upload_done = 0;
+        upload_total = 0;
+        compression_original = 0;
+        compression_sent = 0;
     }
 
     std::vector<CompilationResult> GetCompilationResult(){
@@ -106,6 +164,156 @@ public:
 private:
 
 
+    // waits for response to request, _OK when it came
+    template<typename Response>
+    Status WaitResponse(PLCclient::Reply<Response>& reply, std::chrono::milliseconds timeout, Response* response){
+        if(reply.wait_for(timeout) != std::future_status::ready) return Status::_TIMEOUT;
+
+        std::optional<Response> result = reply.get();
+        if(!result) return Status::_DISCONNECTED;
+
+        *response = std::move(*result);
+        return Status::_OK;
+    }
+
+
+    void AddUploadProgress(uint64_t bytes){
+        std::scoped_lock lock(flag_msg_mutex);
+        upload_done += bytes;
+    }
+
+
+    // older PLC doesn't answer CAPABILITIES and gets plain data
+    void NegotiateCompression(){
+        std::string encoding;
+
+        if(compression){
+            auto reply = plc_client->Capabilities();
+
+            PLCclient::CapabilitiesResponse response;
+            Status status = WaitResponse(reply, timeout_capabilities_duration, &response);
+
+            if(status == Status::_OK && response.result == PLCclient::CapabilitiesResponse::Result::_OK){
+                for(const std::string& accepted: response.compression)
+                    if(accepted == PLCclient::compression_deflate) encoding = accepted;
+            }
+        }
+
+        std::scoped_lock lock(flag_msg_mutex);
+        plc_compression = encoding;
+        compression_original = 0;
+        compression_sent = 0;
+    }
+
+
+    // whole file as hex string in FILE_WRITE, for PLC without binary transfer
+    Status UploadFileHex(const std::string& payload, const std::string& compression, uint64_t original_size, const std::string& name, std::string* msg){
+        auto reply = plc_client->FileWriteStr(payload, name, compression, original_size);
+
+        PLCclient::FileWriteResponse response;
+        Status status = WaitResponse(reply, timeout_duration, &response);
+        if(status != Status::_OK) return status;
+
+        *msg = response.msg;
+        if(response.result == PLCclient::FileWriteResponse::Result::_ERR) return Status::_ERROR;
+
+        AddUploadProgress(original_size);
+        return Status::_OK;
+    }
+
+
+    Status UploadFile(const std::string& data, const std::string& name, std::string* msg){
+        if(!plc_client->IsConnected()) return Status::_DISCONNECTED;
+
+        // compressed only when PLC accepts it and data gets smaller
+        std::string deflated;
+        std::string encoding;
+        if(!plc_compression.empty()){
+            deflated = PLCclient::Deflate(data);
+            if(deflated.size() < data.size()) encoding = plc_compression;
+
+            std::scoped_lock lock(flag_msg_mutex);
+            compression_original += data.size();
+            compression_sent += encoding.empty() ? data.size() : deflated.size();
+        }
+        const std::string& payload = encoding.empty() ? data : deflated;
+
+        if(!plc_binary_transfer) return UploadFileHex(payload, encoding, data.size(), name, msg);
+
+        const uint64_t size = payload.size();
+        const uint32_t checksum = PLCclient::Crc32((const uint8_t*)payload.data(), payload.size());
+        PLCclient::FileTransferResponse response;
+
+        // progress counts bytes of original data
+        uint64_t reported = 0;
+        auto Progress = [&](uint64_t stored){
+            uint64_t original = size ? stored * data.size() / size : data.size();
+            if(original > reported) AddUploadProgress(original - reported);
+            reported = std::max(reported, original);
+        };
+
+        // step 1 - begin, PLC tells how much of this file it already has
+        auto begin = plc_client->FileBegin(name, size, checksum, encoding, data.size());
+        Status status = WaitResponse(begin, timeout_duration, &response);
+        if(status == Status::_TIMEOUT){
+            plc_binary_transfer = false; // PLC without binary transfer ignores FILE_BEGIN
+            return UploadFileHex(payload, encoding, data.size(), name, msg);
+        }
+        if(status != Status::_OK) return status;
+        if(response.result == PLCclient::FileTransferResponse::Result::_ERR){
+            *msg = response.msg;
+            return Status::_ERROR;
+        }
+
+        // step 2 - chunks straight from payload, up to 'window_size' bytes wait for acknowledge,
+        // replies are waited in order chunks were sent
+        uint64_t acked = std::min(response.offset, size);
+        uint64_t sent = acked;
+        uint64_t rewind = UINT64_MAX;
+        std::deque<PLCclient::Reply<PLCclient::FileTransferResponse>> window;
+        Progress(acked);
+
+        while(acked < size){
+            while(sent < size && sent - acked < window_size){
+                size_t len = std::min<uint64_t>(PLCclient::file_chunk_size, size - sent);
+                window.push_back(plc_client->FileChunk(sent, (const uint8_t*)payload.data() + sent, len));
+                sent += len;
+            }
+
+            status = WaitResponse(window.front(), timeout_duration, &response);
+            window.pop_front();
+            if(status != Status::_OK) return status;
+
+            if(response.result == PLCclient::FileTransferResponse::Result::_ERR){
+                // chunk lost, send again from offset PLC expects once chunks after it are answered
+                if(response.offset > size || response.offset == rewind){
+                    *msg = response.msg;
+                    return Status::_ERROR;
+                }
+                for(auto& reply: window){
+                    PLCclient::FileTransferResponse ignored;
+                    status = WaitResponse(reply, timeout_duration, &ignored);
+                    if(status != Status::_OK) return status;
+                }
+                window.clear();
+                rewind = response.offset;
+                acked = sent = response.offset;
+            }else if(response.offset > acked){
+                acked = std::min(response.offset, size);
+            }
+            Progress(acked);
+        }
+
+        // step 3 - PLC checks checksum and writes file
+        auto end = plc_client->FileEnd(name, checksum);
+        status = WaitResponse(end, timeout_duration, &response);
+        if(status != Status::_OK) return status;
+
+        *msg = response.msg;
+        return response.result == PLCclient::FileTransferResponse::Result::_OK ? Status::_OK : Status::_ERROR;
+    }
+
+
     void threadJob() override{
 
         // step 0, reset status flags
@@ -117,6 +325,7 @@ private:
         SetResponseMsg(&code_upload_msg, "");
         SetResponseMsg(&config_upload_msg, "");
         SetResponseMsg(&code_compilation_msg, "");
+        plc_binary_transfer = binary_transfer;
 
         { // step 1, stop currently running application
             if(!plc_client->IsConnected()){
@@ -124,24 +333,15 @@ private:
                 return;    
             }
 
-            plc_client->AppStop();
+            auto reply = plc_client->AppStop();
             SetFlag(&app_stop_flag, Status::_WAIT);
             
             // wait until received response
             PLCclient::AppStopResponse response;
-            auto start_time = std::chrono::high_resolution_clock::now();
-            
-            while(!plc_client->GetIfAppStopResponse(&response)){
-                if(!plc_client->IsConnected()){
-                    SetFlag(&app_stop_flag, Status::_DISCONNECTED);
-                    return;    
-                }
-                std::this_thread::sleep_for(std::chrono::milliseconds(50));
-                auto now = std::chrono::high_resolution_clock::now();
-                if(now > (start_time + timeout_duration)){
-                    SetFlag(&app_stop_flag, Status::_TIMEOUT);
-                    return;
-                }
+            Status status = WaitResponse(reply, timeout_duration, &response);
+            if(status != Status::_OK){
+                SetFlag(&app_stop_flag, status);
+                return;
             }
             
             if(response.result == PLCclient::AppStopResponse::Result::_ERR){
@@ -156,83 +356,42 @@ private:
         }
 
         
-        { // step 2, upload code file
-            if(!plc_client->IsConnected()){
-                SetFlag(&code_upload_flag, Status::_DISCONNECTED);
-                return;    
-            }
+        // step 2, upload code files
+        NegotiateCompression();
+        {
+            std::scoped_lock lock(flag_msg_mutex);
+            upload_done = 0;
+            upload_total = config.size();
+            for(const CodeFile& file: files) upload_total += file.code.size();
+        }
 
-            plc_client->FileWriteStr(code, "file1.cpp");
+        for(size_t i = 0; i < files.size(); i++){ 
             SetFlag(&code_upload_flag, Status::_WAIT);
-            
-            // wait until received response
-            PLCclient::FileWriteResponse response;
-            auto start_time = std::chrono::high_resolution_clock::now();
-            
-            while(!plc_client->GetIfFileWriteResponse(&response)){
-                if(!plc_client->IsConnected()){
-                    SetFlag(&code_upload_flag, Status::_DISCONNECTED);
-                    return;    
-                }
+            if(files.size() > 1)
+                SetResponseMsg(&code_upload_msg, files[i].name + " (" + std::to_string(i+1) + "/" + std::to_string(files.size()) + ")");
 
-                std::this_thread::sleep_for(std::chrono::milliseconds(50));
-                auto now = std::chrono::high_resolution_clock::now();
-                if(now > (start_time + timeout_duration)){
-                    SetFlag(&code_upload_flag, Status::_TIMEOUT);
-                    return;
-                }
-            }
-            
-            if(response.result == PLCclient::FileWriteResponse::Result::_ERR){
+            std::string msg;
+            Status status = UploadFile(files[i].code, files[i].name, &msg);
+            if(status != Status::_OK){
                 // stop thread on error
-                SetFlag(&code_upload_flag, Status::_ERROR);
-                SetResponseMsg(&code_upload_msg, response.msg);
+                SetFlag(&code_upload_flag, status);
+                SetResponseMsg(&code_upload_msg, files[i].name + ": " + msg);
                 return;
-            }else{
+            }else if(i + 1 == files.size()){
                 SetFlag(&code_upload_flag, Status::_OK);
-                SetResponseMsg(&code_upload_msg, response.msg);
+                SetResponseMsg(&code_upload_msg, msg);
             }
-
         }
 
 
         { // step 3, upload config file
-            if(!plc_client->IsConnected()){
-                SetFlag(&config_upload_flag, Status::_DISCONNECTED);
-                return;    
-            }
-            
-            plc_client->FileWriteStr(config, "build.conf");
             SetFlag(&config_upload_flag, Status::_WAIT);
-            
-            // wait until received response
-            PLCclient::FileWriteResponse response;
-            auto start_time = std::chrono::high_resolution_clock::now();
-
-            while(!plc_client->GetIfFileWriteResponse(&response)){
-                if(!plc_client->IsConnected()){
-                    SetFlag(&config_upload_flag, Status::_DISCONNECTED);
-                    return;    
-                }
-
-                std::this_thread::sleep_for(std::chrono::milliseconds(50));
-                auto now = std::chrono::high_resolution_clock::now();
-                if(now > (start_time + timeout_duration)){
-                    SetFlag(&config_upload_flag, Status::_TIMEOUT);
-                    return;
-                }
-            }
-            
-            if(response.result == PLCclient::FileWriteResponse::Result::_ERR){
-                // stop thread on error
-                SetFlag(&config_upload_flag, Status::_ERROR);
-                SetResponseMsg(&config_upload_msg, response.msg);
-                return;
-            }else{
-                SetFlag(&config_upload_flag, Status::_OK);
-                SetResponseMsg(&config_upload_msg, response.msg);
-            }
 
+            std::string msg;
+            Status status = UploadFile(config, "build.conf", &msg);
+            SetFlag(&config_upload_flag, status);
+            SetResponseMsg(&config_upload_msg, msg);
+            if(status != Status::_OK) return;
         }
 
         { // step 4, compile code
@@ -241,25 +400,15 @@ private:
                 return;    
             }
 
-            plc_client->CompileCode();
+            auto reply = plc_client->CompileCode();
             SetFlag(&code_compilation_flag, Status::_WAIT);
 
             // wait until received response
             PLCclient::AppBuildResponse response;
-            auto start_time = std::chrono::high_resolution_clock::now();
-
-            while(!plc_client->GetIfCompileCodeeResponse(&response)){
-                if(!plc_client->IsConnected()){
-                    SetFlag(&code_compilation_flag, Status::_DISCONNECTED);
-                    return;    
-                }
-
-                std::this_thread::sleep_for(std::chrono::milliseconds(50));
-                auto now = std::chrono::high_resolution_clock::now();
-                if(now > (start_time + timeout_compilation_duration)){
-                    SetFlag(&code_compilation_flag, Status::_TIMEOUT);
-                    return;
-                }
+            Status status = WaitResponse(reply, timeout_compilation_duration, &response);
+            if(status != Status::_OK){
+                SetFlag(&code_compilation_flag, status);
+                return;
             }
 
             if(response.result == PLCclient::AppBuildResponse::Result::_ERR){
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <ostream>
+#include <charconv>
+#include <cstdint>
+
+
+
+// Append-only text buffer used by code generators.
+// Text is collected in one reserved std::string; when a sink stream is given
+// the buffer is flushed into it in large chunks instead of growing further.
+class CodeWriter {
+
+public:
+
+    static constexpr size_t FLUSH_SIZE = 256 * 1024;
+
+    CodeWriter(size_t reserve = 0, std::ostream* _sink = nullptr): sink(_sink){
+        buffer.reserve(sink ? FLUSH_SIZE + 4096 : reserve);
+    }
+    ~CodeWriter(){ Flush(); }
+
+    CodeWriter(const CodeWriter&) = delete;
+    CodeWriter& operator=(const CodeWriter&) = delete;
+
+
+    CodeWriter& operator<<(std::string_view text){
+        buffer.append(text);
+        if(sink && buffer.size() >= FLUSH_SIZE) Flush();
+        return *this;
+    }
+
+    CodeWriter& operator<<(const char* text){ return *this << std::string_view(text); }
+    CodeWriter& operator<<(const std::string& text){ return *this << std::string_view(text); }
+
+    CodeWriter& operator<<(char c){
+        buffer.push_back(c);
+        return *this;
+    }
+
+    CodeWriter& operator<<(int value){ return Integer(value); }
+    CodeWriter& operator<<(int64_t value){ return Integer(value); }
+    CodeWriter& operator<<(size_t value){ return Integer(value); }
+
+
+    // same text as 'std::setprecision(precision)' applied to a default formatted stream
+    CodeWriter& Double(double value, int precision = 18){
+        char tmp[64];
+        auto res = std::to_chars(tmp, tmp + sizeof(tmp), value, std::chars_format::general, precision);
+        return *this << std::string_view(tmp, res.ptr - tmp);
+    }
+
+
+    // pre-size the buffer for the expected output; ignored when writing into a sink
+    void Reserve(size_t size){
+        if(!sink && buffer.capacity() < size) buffer.reserve(size);
+    }
+
+
+    // move buffered text into the sink; no-op when writing into the buffer only
+    void Flush(){
+        if(!sink || buffer.empty()) return;
+        sink->write(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+
+
+    // whole output when no sink is used
+    std::string Release(){ return std::move(buffer); }
+
+    size_t Size() const { return buffer.size(); }
+
+private:
+
+    template<typename T>
+    CodeWriter& Integer(T value){
+        char tmp[24];
+        auto res = std::to_chars(tmp, tmp + sizeof(tmp), value);
+        return *this << std::string_view(tmp, res.ptr - tmp);
+    }
+
+    std::string buffer;
+    std::ostream* sink;
+};
+
+
+
+// generated source file
+struct CodeFile {
+    std::string name;
+    std::string code;
+};
@@ -3,6 +3,8 @@
 #include <imgui.h>
 #include <list>
 #include <functional>
+#include <algorithm>
+#include <misc/cpp/imgui_stdlib.h>
 #include "window_object.hpp"
 #include "schematic.hpp"
 
@@ -20,13 +22,16 @@ private:
 
     std::vector<int> selected_blocks_id;
     std::function<void(std::vector<int>)> on_select_callback;
+    std::function<void()> on_analyze_callback;
 
 public:
 
     enum class CalculationMethod{ AutoAnyChange, AutoCompileOnly, Manual };
 
 
-    ExecutionOrderWindow(const std::string& name, Schematic* s): WindowObject(name), schematic(s){}
+    ExecutionOrderWindow(const std::string& name, Schematic* s): WindowObject(name), schematic(s){
+        schematic->SetIncrementalOrder(calculation_method == CalculationMethod::AutoAnyChange);
+    }
     ~ExecutionOrderWindow(){}
 
 
@@ -52,23 +57,35 @@ public:
         on_select_callback = callback;
     }
 
+    // called to refresh partitioning for parallel execution
+    void OnAnalyze(std::function<void()> callback){
+        on_analyze_callback = callback;
+    }
+
 
 
 private:
 
-    CalculationMethod calculation_method = CalculationMethod::AutoCompileOnly;
+    CalculationMethod calculation_method = CalculationMethod::AutoAnyChange;
 
     int selected_index = -1;
 
     void WindowContent(){
 
         ImGui::Text("Set execution order:");
-        if(ImGui::RadioButton("Auto (on compile)", calculation_method == CalculationMethod::AutoCompileOnly)) 
-            calculation_method = CalculationMethod::AutoCompileOnly;
-        if(ImGui::RadioButton("Auto (always - not recomended)", calculation_method == CalculationMethod::AutoAnyChange)) 
+        if(ImGui::RadioButton("Auto (always)", calculation_method == CalculationMethod::AutoAnyChange)){
             calculation_method = CalculationMethod::AutoAnyChange;
-        if(ImGui::RadioButton("Manualy", calculation_method == CalculationMethod::Manual)) 
+            schematic->SetIncrementalOrder(true);
+            schematic->UpdateOrder();
+        }
+        if(ImGui::RadioButton("Auto (on compile)", calculation_method == CalculationMethod::AutoCompileOnly)){
+            calculation_method = CalculationMethod::AutoCompileOnly;
+            schematic->SetIncrementalOrder(false);
+        }
+        if(ImGui::RadioButton("Manualy", calculation_method == CalculationMethod::Manual)){
             calculation_method = CalculationMethod::Manual;
+            schematic->SetIncrementalOrder(false);
+        }
 
         ImGui::Separator();
 
@@ -77,19 +94,71 @@ private:
         if(ImGui::RadioButton("Move", drag_and_drop_behaviour == DragAndDropBehaviour::Move)) drag_and_drop_behaviour = DragAndDropBehaviour::Move;
         ImGui::EndDisabled();
 
+        ImGui::Separator();
+
+        // feedback loops found during last sorting, analysis or compilation
+        auto feedback_loops = schematic->FeedbackLoops();
+        if(feedback_loops.empty()){
+            ImGui::TextColored(ImColor(0,255,0), "Feedback loops: 0");
+        }else{
+            ImGui::TextColored(ImColor(255,0,0), "Feedback loops: %d", (int)feedback_loops.size());
+            ImGui::SameLine();
+            HelpMarker("Blocks in feedback loop read output of block executed later (value from previous cycle).\n"
+                       "Click on loop to select its blocks.");
+
+            ImGui::Indent();
+            for(int i = 0; i < feedback_loops.size(); i++){
+                std::string loop_str = "Loop " + std::to_string(i) + ": ";
+                for(int id: feedback_loops[i]) loop_str += std::to_string(id) + " ";
+
+                ImGui::PushID(i);
+                if(ImGui::Selectable(loop_str.c_str())){
+                    ClearID();
+                    for(int id: feedback_loops[i]) SelectID(id);
+                    if(on_select_callback) on_select_callback(selected_blocks_id);
+                }
+                ImGui::PopID();
+            }
+            ImGui::Unindent();
+        }
+
+        ImGui::Separator();
+
+        // partitioning from last build or analysis
+        const Schematic::CodeReport& report = schematic->GetCodeReport();
+        if(ImGui::Button("Analyze") && on_analyze_callback) on_analyze_callback();
+        ImGui::SameLine();
+        if(report.expected_speedup == 0.0)
+            ImGui::TextDisabled("Parallel execution: off");
+        else
+            ImGui::Text("%s", report.ParallelToString().c_str());
+        ImGui::SameLine();
+        HelpMarker("Set number of workers in build config. Blocks in the same phase and different worker run at once,\n"
+                   "serial phases (IO, memory, time and other not pure blocks) run on the main thread.");
+
+        ImGui::Separator();
+
+        TasksContent();
+
+        ImGui::Separator();
+
         // columns:
         // 0 - execution order number
         // 1 - block name
+        // 2 - task
+        // 3 - phase and worker of parallel execution
 
         
         ImGuiTableFlags table_flags = ImGuiTableFlags_BordersV 
                                     | ImGuiTableFlags_BordersOuter 
                                     | ImGuiTableFlags_SizingStretchProp;
 
-        ImGui::BeginTable("##ExecOrder", 3, table_flags);
+        ImGui::BeginTable("##ExecOrder", 5, table_flags);
         ImGui::TableSetupColumn("#");
         ImGui::TableSetupColumn("ID");
         ImGui::TableSetupColumn("Name");
+        ImGui::TableSetupColumn("Task");
+        ImGui::TableSetupColumn("Part");
         ImGui::TableHeadersRow();
 
 
@@ -174,9 +243,26 @@ private:
             // block name
             ImGui::TableSetColumnIndex(2);
             if(block != nullptr){
-                ImGui::Text(block->full_name.c_str());
+                if(schematic->IsInFeedbackLoop(block->id))
+                    ImGui::TextColored(ImColor(255,0,0), "%s", block->full_name.c_str());
+                else
+                    ImGui::Text("%s", block->full_name.c_str());
             } 
 
+            // task
+            ImGui::TableSetColumnIndex(3);
+            ImGui::Text("%s", schematic->tasks[schematic->TaskOf(*block)].name.c_str());
+
+            // phase / worker
+            ImGui::TableSetColumnIndex(4);
+            auto part = report.partition.find(block->id);
+            if(part == report.partition.end())
+                ImGui::TextDisabled("-");
+            else if(part->second.worker < 0)
+                ImGui::Text("%d serial", part->second.phase);
+            else
+                ImGui::TextColored(ImColor::HSV(part->second.worker / (float)report.workers, 0.6f, 1.0f), "%d worker %d", part->second.phase, part->second.worker);
+
             ImGui::PopID();
             index++;
         }
@@ -187,10 +273,10 @@ private:
 
         if(do_drag_and_drop){
             if(drag_and_drop_behaviour == DragAndDropBehaviour::Swap){
-                SwapBlocks(drag_and_drop_source, drag_and_drop_target);
+                schematic->SwapBlocks(drag_and_drop_source, drag_and_drop_target);
             }
             if(drag_and_drop_behaviour == DragAndDropBehaviour::Move){
-                MoveBlocks(drag_and_drop_source, drag_and_drop_target);
+                schematic->MoveBlock(drag_and_drop_source, drag_and_drop_target);
             }
         }
 
@@ -202,37 +288,80 @@ private:
 
 private:
 
-    void SwapBlocks(std::list<std::shared_ptr<Schematic::Block>>::iterator iter1, std::list<std::shared_ptr<Schematic::Block>>::iterator iter2){
-        std::shared_ptr<Schematic::Block> temp_block1 = *iter1;
-        std::shared_ptr<Schematic::Block> temp_block2 = *iter2;
-        *iter1 = temp_block2;
-        *iter2 = temp_block1;
-    }
+    // task list, every task can be edited and selected blocks moved into it
+    void TasksContent(){
+        if(!ImGui::CollapsingHeader("Tasks")) return;
+
+        ImGui::SameLine();
+        HelpMarker("Blocks of a task run every 'period' cycles, in cycles where cycle % period == offset.\n"
+                   "Tasks due in the same cycle run one after another, higher priority first,\n"
+                   "so a task always reads outputs of the last completed run of other tasks.");
+
+        int remove_task = -1;
+
+        ImGuiTableFlags table_flags = ImGuiTableFlags_BordersV 
+                                    | ImGuiTableFlags_BordersOuter 
+                                    | ImGuiTableFlags_SizingStretchProp;
+
+        ImGui::BeginTable("##Tasks", 5, table_flags);
+        ImGui::TableSetupColumn("Name");
+        ImGui::TableSetupColumn("Period");
+        ImGui::TableSetupColumn("Offset");
+        ImGui::TableSetupColumn("Priority");
+        ImGui::TableSetupColumn("");
+        ImGui::TableHeadersRow();
+
+        for(int i = 0; i < schematic->tasks.size(); i++){
+            Schematic::Task& task = schematic->tasks[i];
+
+            ImGui::PushID(i);
+            ImGui::TableNextRow();
+
+            ImGui::TableSetColumnIndex(0);
+            ImGui::PushItemWidth(-1);
+            ImGui::InputText("##name", &task.name);
+            ImGui::PopItemWidth();
 
-    void MoveBlocks(std::list<std::shared_ptr<Schematic::Block>>::iterator from, std::list<std::shared_ptr<Schematic::Block>>::iterator to){
-        // check which element is first
-        bool source_first;
-        for(auto iter = schematic->blocks.begin(); iter != schematic->blocks.end(); iter++ ){
-            if(from == iter){
-                source_first = true; 
-                break;
+            ImGui::TableSetColumnIndex(1);
+            ImGui::PushItemWidth(-1);
+            if(ImGui::InputInt("##period", &task.period)) task.period = std::max(task.period, 1);
+            ImGui::PopItemWidth();
+
+            ImGui::TableSetColumnIndex(2);
+            ImGui::PushItemWidth(-1);
+            ImGui::InputInt("##offset", &task.offset);
+            ImGui::PopItemWidth();
+            task.offset = std::clamp(task.offset, 0, task.period - 1);
+
+            ImGui::TableSetColumnIndex(3);
+            ImGui::PushItemWidth(-1);
+            ImGui::InputInt("##priority", &task.priority);
+            ImGui::PopItemWidth();
+
+            ImGui::TableSetColumnIndex(4);
+            ImGui::BeginDisabled(selected_blocks_id.empty());
+            if(ImGui::Button("Assign selected")){
+                for(int id: selected_blocks_id) schematic->SetBlockTask(id, i);
             }
-            if(to == iter){
-                source_first = false; 
-                break;
+            ImGui::EndDisabled();
+            if(i != 0){
+                ImGui::SameLine();
+                if(ImGui::Button("Remove")) remove_task = i;
             }
+
+            ImGui::PopID();
         }
 
-        std::shared_ptr<Schematic::Block> temp_block = *from;
-        schematic->blocks.erase(from);
+        ImGui::EndTable();
+
+        if(remove_task > 0) schematic->RemoveTask(remove_task);
 
-        if(source_first){
-            to++;
-            schematic->blocks.insert(to, temp_block);
-        }else{
-            schematic->blocks.insert(to, temp_block);
+        if(ImGui::Button("Add task")){
+            Schematic::Task task;
+            task.name = "task" + std::to_string(schematic->tasks.size());
+            task.period = 10;
+            schematic->AddTask(task);
         }
-
     }
 
     bool IsIDselected(int id){
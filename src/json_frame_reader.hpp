@@ -0,0 +1,99 @@
+#pragma once
+
+#include <boost/json.hpp>
+#include <vector>
+#include <atomic>
+#include <cstring>
+
+
+
+// Splits received bytes into newline terminated JSON messages.
+//
+// Complete lines of received data are parsed where they are, only a line split between two
+// reads is copied to a buffer which grows to the size of the longest line. A line longer than
+// max frame size is reported once and dropped up to its newline, so one broken message can't
+// exhaust memory or desynchronize the stream.
+class JsonFrameReader{
+
+public:
+    enum class Error{ PARSE, FRAME_TOO_LARGE };
+
+    static constexpr size_t default_max_frame_size = 16 * 1024 * 1024;
+
+    explicit JsonFrameReader(size_t max_frame = default_max_frame_size): max_frame_size(max_frame) {}
+
+    void SetMaxFrameSize(size_t size){ max_frame_size = size; }
+    size_t GetMaxFrameSize() const { return max_frame_size; }
+
+    // bytes of unfinished line waiting for the rest
+    size_t Pending() const { return buffer.size(); }
+
+    void Reset(){
+        buffer.clear();
+        discarding = false;
+    }
+
+
+    // calls on_message(const boost::json::value&) for every complete message,
+    // on_error(Error) for message which can't be parsed or is too large
+    template<typename OnMessage, typename OnError>
+    void Feed(const char* data, size_t len, OnMessage&& on_message, OnError&& on_error){
+        const char* const end = data + len;
+        const size_t max_frame = max_frame_size;
+
+        while(data < end){
+            const char* newline = (const char*)std::memchr(data, '\n', end - data);
+            const char* frame_end = newline ? newline : end;
+
+            if(!discarding && buffer.size() + (frame_end - data) > max_frame){
+                discarding = true;
+                buffer.clear();
+                on_error(Error::FRAME_TOO_LARGE);
+            }
+
+            if(!newline){
+                if(!discarding) buffer.insert(buffer.end(), data, end);
+                return;
+            }
+
+            if(!discarding){
+                if(buffer.empty()){
+                    Parse(data, newline - data, on_message, on_error); // whole line in received data, no copy
+                }else{
+                    buffer.insert(buffer.end(), data, newline);
+                    Parse(buffer.data(), buffer.size(), on_message, on_error);
+                    buffer.clear();
+                }
+            }
+
+            discarding = false;
+            data = newline + 1;
+        }
+    }
+
+
+private:
+    std::atomic<size_t> max_frame_size;
+    std::vector<char> buffer;    // start of line received in previous reads
+    bool discarding = false;     // rest of too large line is skipped
+    boost::json::parser parser;
+
+
+    template<typename OnMessage, typename OnError>
+    void Parse(const char* frame, size_t size, OnMessage&& on_message, OnError&& on_error){
+        // empty lines and "\r\n" line endings are allowed
+        while(size && (frame[size - 1] == '\r' || frame[size - 1] == ' ' || frame[size - 1] == '\t')) size--;
+        if(size == 0) return;
+
+        boost::system::error_code ec;
+        parser.reset();
+        parser.write(frame, size, ec);
+
+        if(!ec && parser.done()){
+            boost::json::value js = parser.release();
+            on_message(js);
+        }else{
+            on_error(Error::PARSE);
+        }
+    }
+};
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <boost/json/basic_parser.hpp>
+#include <boost/json/basic_parser_impl.hpp>
+
+
+
+// Streaming (SAX) json loading without building boost::json::value DOM.
+//
+// JsonSax::Handler is base for boost::json::basic_parser handlers. It joins keys and strings
+// delivered in parts, keeps stack of containers and forwards only complete events to Derived:
+//
+//   Ctx  Enter(Ctx parent, JsonSax::Kind kind);             // object/array started inside 'parent'
+//   void Leave(Ctx ctx);                                    // object/array finished
+//   void OnValue(Ctx parent, const JsonSax::Value& value);  // scalar value inside 'parent'
+//
+// 'key' holds name of the current value when parent is an object. Ctx must have ROOT (document
+// level) and SKIP; containers entered as SKIP are not reported, together with their content.
+//
+namespace JsonSax {
+
+    enum class Kind { OBJECT, ARRAY, NUL, BOOL, INT64, UINT64, DOUBLE, STRING };
+
+    struct Value {
+        Kind kind;
+        bool boolean = false;
+        int64_t int64 = 0;
+        uint64_t uint64 = 0;
+        double real = 0.0;
+        std::string_view string;
+
+        bool IsInt() const { return kind == Kind::INT64 || kind == Kind::UINT64; }
+        int64_t AsInt() const { return kind == Kind::UINT64 ? (int64_t)uint64 : int64; }
+    };
+
+
+    // same options as used with boost::json::parse before
+    inline boost::json::parse_options Options(){
+        boost::json::parse_options opt;
+        opt.allow_comments = true;          // 1) allow comments in json
+        opt.allow_trailing_commas = true;   // 2) allow trailing commas
+        return opt;
+    }
+
+
+    // parse whole document, false on syntax error
+    template<class Handler>
+    bool Parse(boost::json::basic_parser<Handler>& parser, std::string_view data){
+        boost::json::error_code ec;
+        size_t n = parser.write_some(false, data.data(), data.size(), ec);
+        if(ec) return false;
+        return n == data.size();
+    }
+
+
+    template<class Derived, class Ctx>
+    class Handler {
+
+    public:
+        static constexpr std::size_t max_object_size = std::size_t(-1);
+        static constexpr std::size_t max_array_size = std::size_t(-1);
+        static constexpr std::size_t max_key_size = std::size_t(-1);
+        static constexpr std::size_t max_string_size = std::size_t(-1);
+
+        Handler(){ stack.push_back(Ctx::ROOT); }
+
+        bool on_document_begin(boost::json::error_code&){ return true; }
+        bool on_document_end(boost::json::error_code&){ return true; }
+
+        bool on_object_begin(boost::json::error_code&){ Open(Kind::OBJECT); return true; }
+        bool on_object_end(std::size_t, boost::json::error_code&){ Close(); return true; }
+        bool on_array_begin(boost::json::error_code&){ Open(Kind::ARRAY); return true; }
+        bool on_array_end(std::size_t, boost::json::error_code&){ Close(); return true; }
+
+        bool on_key_part(boost::json::string_view s, std::size_t, boost::json::error_code&){
+            part.append(s.data(), s.size());
+            return true;
+        }
+        bool on_key(boost::json::string_view s, std::size_t, boost::json::error_code&){
+            key.assign(part).append(s.data(), s.size());
+            part.clear();
+            return true;
+        }
+
+        bool on_string_part(boost::json::string_view s, std::size_t, boost::json::error_code&){
+            if(stack.back() != Ctx::SKIP) part.append(s.data(), s.size());
+            return true;
+        }
+        bool on_string(boost::json::string_view s, std::size_t, boost::json::error_code&){
+            Value v{Kind::STRING};
+            if(part.empty()){
+                v.string = std::string_view(s.data(), s.size());
+                Scalar(v);
+            }else{
+                part.append(s.data(), s.size());
+                v.string = part;
+                Scalar(v);
+                part.clear();
+            }
+            return true;
+        }
+
+        bool on_number_part(boost::json::string_view, boost::json::error_code&){ return true; }
+        bool on_int64(int64_t i, boost::json::string_view, boost::json::error_code&){ Value v{Kind::INT64}; v.int64 = i; Scalar(v); return true; }
+        bool on_uint64(uint64_t u, boost::json::string_view, boost::json::error_code&){ Value v{Kind::UINT64}; v.uint64 = u; Scalar(v); return true; }
+        bool on_double(double d, boost::json::string_view, boost::json::error_code&){ Value v{Kind::DOUBLE}; v.real = d; Scalar(v); return true; }
+        bool on_bool(bool b, boost::json::error_code&){ Value v{Kind::BOOL}; v.boolean = b; Scalar(v); return true; }
+        bool on_null(boost::json::error_code&){ Scalar(Value{Kind::NUL}); return true; }
+
+        bool on_comment_part(boost::json::string_view, boost::json::error_code&){ return true; }
+        bool on_comment(boost::json::string_view, boost::json::error_code&){ return true; }
+
+    protected:
+        std::string key;
+
+    private:
+        std::vector<Ctx> stack;
+        std::string part;
+
+        Derived& Self(){ return static_cast<Derived&>(*this); }
+
+        void Open(Kind kind){
+            Ctx parent = stack.back();
+            stack.push_back(parent == Ctx::SKIP ? Ctx::SKIP : Self().Enter(parent, kind));
+        }
+
+        void Close(){
+            Ctx ctx = stack.back();
+            stack.pop_back();
+            if(ctx != Ctx::SKIP) Self().Leave(ctx);
+        }
+
+        void Scalar(const Value& v){
+            if(stack.back() != Ctx::SKIP) Self().OnValue(stack.back(), v);
+        }
+    };
+
+}
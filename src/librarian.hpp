@@ -2,6 +2,7 @@
 
 #include <filesystem>
 #include <memory>
+#include <list>
 #include "schematic_block.hpp"
 
 
@@ -1,8 +1,13 @@
 #include "schematic.hpp"
 #include <boost/json.hpp>
-#include <boost/algorithm/string.hpp>
+#include "json_sax.hpp"
 #include <vector>
-#include <sstream>
+#include <algorithm>
+#include <queue>
+#include <functional>
+#include <cstring>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 
 
 const char* Schematic::ErrorToStr(Error err) {
@@ -32,12 +37,24 @@ const char* Schematic::ErrorToStr(Error err) {
 	case Error::JSON_BLOCK_MISSING_NAME: return "JSON_BLOCK_MISSING_NAME";
 	case Error::JSON_BLOCK_PARAMETER_INVALID_TYPE: return "JSON_BLOCK_PARAMETER_INVALID_TYPE";
 	case Error::JSON_BLOCK_PARAMS_NOT_ARRAY: return "JSON_BLOCK_PARAMS_NOT_ARRAY";
+	case Error::JSON_BLOCK_INVALID_TASK: return "JSON_BLOCK_INVALID_TASK";
+	case Error::JSON_TASKS_FIELD_NOT_ARRAY: return "JSON_TASKS_FIELD_NOT_ARRAY";
+	case Error::JSON_TASK_NOT_AN_OBJECT: return "JSON_TASK_NOT_AN_OBJECT";
+	case Error::JSON_TASK_IS_INVALID: return "JSON_TASK_IS_INVALID";
 	case Error::JSON_CONNECTION_NOT_AN_OBJECT: return "JSON_CONNECTION_NOT_AN_OBJECT";
 	case Error::JSON_CONNECTION_IS_INVALID: return "JSON_CONNECTION_IS_INVALID";
 	case Error::JSON_CONNECTION_INVALID_SRC: return "JSON_CONNECTION_INVALID_SRC";
 	case Error::JSON_CONNECTION_INVALID_SRCPIN: return "JSON_CONNECTION_INVALID_SRCPIN";
 	case Error::JSON_CONNECTION_INVALID_DST: return "JSON_CONNECTION_INVALID_DST";
 	case Error::JSON_CONNECTION_INVALID_DSTPIN: return "JSON_CONNECTION_INVALID_DSTPIN";
+	case Error::BINARY_INVALID_HEADER: return "BINARY_INVALID_HEADER";
+	case Error::BINARY_UNSUPPORTED_VERSION: return "BINARY_UNSUPPORTED_VERSION";
+	case Error::BINARY_TRUNCATED: return "BINARY_TRUNCATED";
+	case Error::BINARY_INVALID_BLOCK: return "BINARY_INVALID_BLOCK";
+	case Error::BINARY_INVALID_CONNECTION: return "BINARY_INVALID_CONNECTION";
+	case Error::BINARY_INVALID_PARAMETER: return "BINARY_INVALID_PARAMETER";
+	case Error::BINARY_INVALID_TASK: return "BINARY_INVALID_TASK";
+	case Error::BLOCK_CODE_NOT_GENERATED: return "BLOCK_CODE_NOT_GENERATED";
 	default: return "Unnown Error";
 	}
 }
@@ -48,6 +65,14 @@ Schematic::Error Schematic::Read(const std::filesystem::path& _path) {
 
 	path = _path;
 
+	// binary files are recognized by content, not by extension
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::in);
+		char magic[sizeof(SchematicBinary::MAGIC)] = {};
+		if(file.read(magic, sizeof(magic)) && SchematicBinary::HasMagic(magic, sizeof(magic)))
+			return ReadBinary(path);
+	}
+
 	std::string data_str;
 	Error file_err = LoadFile(path, &data_str);
 	if (file_err != Error::OK) return file_err;
@@ -57,6 +82,250 @@ Schematic::Error Schematic::Read(const std::filesystem::path& _path) {
 }
 
 
+Schematic::Error Schematic::ReadBinary(const std::filesystem::path& _path) {
+	try {
+		boost::interprocess::file_mapping file(_path.string().c_str(), boost::interprocess::read_only);
+		boost::interprocess::mapped_region region(file, boost::interprocess::read_only);
+
+		return ParseBinary(static_cast<const char*>(region.get_address()), region.get_size());
+	}
+	catch(...) {
+		return Error::CANNOT_OPEN_FILE;
+	}
+}
+
+
+Schematic::Error Schematic::ParseBinary(const char* data, size_t size) {
+	using namespace SchematicBinary;
+
+	// records are copied out of the buffer, so data doesn't have to be aligned
+	auto Get = [data](auto* record, size_t offset){ std::memcpy(record, data + offset, sizeof(*record)); };
+
+	// step 1 - header
+	Header header;
+	if(size < sizeof(Header)) return Error::BINARY_INVALID_HEADER;
+	Get(&header, 0);
+
+	if(!HasMagic(header.magic, sizeof(header.magic))) return Error::BINARY_INVALID_HEADER;
+	if(header.version < MIN_VERSION || header.version > VERSION) return Error::BINARY_UNSUPPORTED_VERSION;
+
+	const uint64_t blocks_offset = sizeof(Header);
+	const uint64_t connections_offset = blocks_offset + (uint64_t)header.block_count * sizeof(BlockRecord);
+	const uint64_t parameters_offset = connections_offset + (uint64_t)header.connection_count * sizeof(ConnectionRecord);
+	const uint64_t tasks_offset = parameters_offset + (uint64_t)header.parameter_count * sizeof(ParameterRecord);
+	const uint64_t strings_offset = tasks_offset + (uint64_t)header.task_count * sizeof(TaskRecord);
+	const uint64_t end_offset = strings_offset + header.string_table_size;
+
+	if(end_offset > size) return Error::BINARY_TRUNCATED;
+
+	const char* strings = data + strings_offset;
+	auto IsValidString = [&header](uint32_t offset, uint32_t str_size){ return (uint64_t)offset + str_size <= header.string_table_size; };
+
+	// step 2 - validate all records before current schematic is replaced
+	for(uint32_t i = 0; i < header.block_count; i++){
+		BlockRecord rec;
+		Get(&rec, blocks_offset + i * sizeof(BlockRecord));
+		if(!IsValidString(rec.name_offset, rec.name_size)) return Error::BINARY_INVALID_BLOCK;
+		if((uint64_t)rec.first_parameter + rec.parameter_count > header.parameter_count) return Error::BINARY_INVALID_BLOCK;
+		if(rec.task != 0 && rec.task >= header.task_count) return Error::BINARY_INVALID_BLOCK;
+	}
+
+	for(uint32_t i = 0; i < header.connection_count; i++){
+		ConnectionRecord rec;
+		Get(&rec, connections_offset + i * sizeof(ConnectionRecord));
+		if(!ConnectionRaw(rec.src, rec.src_pin, rec.dst, rec.dst_pin).IsValid()) return Error::BINARY_INVALID_CONNECTION;
+	}
+
+	for(uint32_t i = 0; i < header.parameter_count; i++){
+		ParameterRecord rec;
+		Get(&rec, parameters_offset + i * sizeof(ParameterRecord));
+		if(rec.type > ParameterType::STRING) return Error::BINARY_INVALID_PARAMETER;
+		if(rec.type == ParameterType::STRING && !IsValidString(rec.string.offset, rec.string.size)) return Error::BINARY_INVALID_PARAMETER;
+	}
+
+	std::vector<Task> tasks_read;
+	for(uint32_t i = 0; i < header.task_count; i++){
+		TaskRecord rec;
+		Get(&rec, tasks_offset + i * sizeof(TaskRecord));
+		if(!IsValidString(rec.name_offset, rec.name_size)) return Error::BINARY_INVALID_TASK;
+
+		Task task{std::string(strings + rec.name_offset, rec.name_size), rec.period, rec.offset, rec.priority};
+		if(!task.IsValid()) return Error::BINARY_INVALID_TASK;
+		tasks_read.push_back(std::move(task));
+	}
+	if(tasks_read.empty()) tasks_read.push_back(Task{"main"});
+
+	// step 3 - build schematic
+	tasks = std::move(tasks_read);
+	blocks.clear();
+	connetions.clear();
+	block_index.clear();
+	connection_index.clear();
+	links_index.clear();
+
+	block_index.reserve(header.block_count);
+	connection_index.reserve(header.connection_count);
+	links_index.reserve(header.block_count);
+
+	for(uint32_t i = 0; i < header.block_count; i++){
+		BlockRecord rec;
+		Get(&rec, blocks_offset + i * sizeof(BlockRecord));
+
+		auto block = std::make_shared<Block>();
+		block->id = rec.id;
+		block->pos.x = rec.x;
+		block->pos.y = rec.y;
+		block->task = rec.task;
+		block->full_name.assign(strings + rec.name_offset, rec.name_size);
+		block->parameters.reserve(rec.parameter_count);
+
+		for(uint32_t p = 0; p < rec.parameter_count; p++){
+			ParameterRecord par;
+			Get(&par, parameters_offset + (uint64_t)(rec.first_parameter + p) * sizeof(ParameterRecord));
+
+			switch(par.type){
+			case ParameterType::NONE:   block->parameters.emplace_back<std::monostate>(std::monostate()); break;
+			case ParameterType::BOOL:   block->parameters.emplace_back(par.boolean != 0); break;
+			case ParameterType::INT64:  block->parameters.emplace_back(par.int64); break;
+			case ParameterType::DOUBLE: block->parameters.emplace_back(par.real); break;
+			case ParameterType::STRING: block->parameters.emplace_back(std::string(strings + par.string.offset, par.string.size)); break;
+			}
+		}
+
+		blocks.push_back(block);
+		block_index[block->id] = block;
+	}
+
+	int conn_id = 1;
+	for(uint32_t i = 0; i < header.connection_count; i++){
+		ConnectionRecord rec;
+		Get(&rec, connections_offset + i * sizeof(ConnectionRecord));
+
+		connetions.emplace_back(conn_id++, FindBlock(rec.src), rec.src_pin, FindBlock(rec.dst), rec.dst_pin);
+		IndexConnection(std::prev(connetions.end()));
+	}
+
+	FinishLoading();
+
+	return Error::OK;
+}
+
+
+Schematic::Error Schematic::SerializeBinary(std::string* data) {
+	using namespace SchematicBinary;
+
+	std::vector<BlockRecord> block_records;
+	std::vector<ConnectionRecord> connection_records;
+	std::vector<ParameterRecord> parameter_records;
+	std::vector<TaskRecord> task_records;
+	std::string strings;
+	std::unordered_map<std::string, uint32_t> name_offsets;
+
+	block_records.reserve(blocks.size());
+	connection_records.reserve(connetions.size());
+
+	auto AddString = [&strings](const std::string& str) -> uint32_t {
+		uint32_t offset = strings.size();
+		strings += str;
+		return offset;
+	};
+
+	// step 1 - blocks and parameters
+	for(const auto& block_ptr: blocks){
+		if(!block_ptr) continue;
+
+		BlockRecord rec = {};
+		rec.id = block_ptr->id;
+		rec.x = block_ptr->pos.x;
+		rec.y = block_ptr->pos.y;
+		rec.task = TaskOf(*block_ptr);
+
+		// block names repeat a lot, so equal names share one string
+		std::string name = block_ptr->GetFullName();
+		auto name_it = name_offsets.find(name);
+		if(name_it == name_offsets.end())
+			name_it = name_offsets.emplace(name, AddString(name)).first;
+		rec.name_offset = name_it->second;
+		rec.name_size = name.size();
+
+		rec.first_parameter = parameter_records.size();
+		rec.parameter_count = block_ptr->parameters.size();
+
+		for(const auto& p: block_ptr->parameters){
+			ParameterRecord par = {};
+			if(std::holds_alternative<bool>(p)){
+				par.type = ParameterType::BOOL;
+				par.boolean = std::get<bool>(p);
+			}else if(std::holds_alternative<int64_t>(p)){
+				par.type = ParameterType::INT64;
+				par.int64 = std::get<int64_t>(p);
+			}else if(std::holds_alternative<double>(p)){
+				par.type = ParameterType::DOUBLE;
+				par.real = std::get<double>(p);
+			}else if(std::holds_alternative<std::string>(p)){
+				par.type = ParameterType::STRING;
+				par.string.size = std::get<std::string>(p).size();
+				par.string.offset = AddString(std::get<std::string>(p));
+			}else{
+				par.type = ParameterType::NONE;
+			}
+			parameter_records.push_back(par);
+		}
+
+		block_records.push_back(rec);
+	}
+
+	// step 2 - connections
+	for(const auto& conn: connetions){
+		auto src = conn.src.lock();
+		auto dst = conn.dst.lock();
+		if (!src || !dst) continue;
+
+		connection_records.push_back({src->id, conn.src_pin, dst->id, conn.dst_pin});
+	}
+
+	// step 3 - tasks, default single task is not stored
+	if(IsMultiTask() || tasks[0].name != "main"){
+		for(const auto& task: tasks){
+			TaskRecord rec = {};
+			rec.name_size = task.name.size();
+			rec.name_offset = AddString(task.name);
+			rec.period = task.period;
+			rec.offset = task.offset;
+			rec.priority = task.priority;
+			task_records.push_back(rec);
+		}
+	}
+
+	// step 4 - write file image
+	Header header = {};
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.block_count = block_records.size();
+	header.connection_count = connection_records.size();
+	header.parameter_count = parameter_records.size();
+	header.string_table_size = strings.size();
+	header.task_count = task_records.size();
+
+	data->clear();
+	data->reserve(sizeof(Header) 
+		+ block_records.size() * sizeof(BlockRecord) 
+		+ connection_records.size() * sizeof(ConnectionRecord) 
+		+ parameter_records.size() * sizeof(ParameterRecord) 
+		+ task_records.size() * sizeof(TaskRecord) 
+		+ strings.size());
+
+	data->append(reinterpret_cast<const char*>(&header), sizeof(header));
+	data->append(reinterpret_cast<const char*>(block_records.data()), block_records.size() * sizeof(BlockRecord));
+	data->append(reinterpret_cast<const char*>(connection_records.data()), connection_records.size() * sizeof(ConnectionRecord));
+	data->append(reinterpret_cast<const char*>(parameter_records.data()), parameter_records.size() * sizeof(ParameterRecord));
+	data->append(reinterpret_cast<const char*>(task_records.data()), task_records.size() * sizeof(TaskRecord));
+	data->append(strings);
+
+	return Error::OK;
+}
+
+
 
 // this function is based on code from:
 // https://cplusplus.com/reference/istream/istream/read/
@@ -113,257 +382,424 @@ Schematic::Error Schematic::SaveFile(const std::filesystem::path& _path, const s
 
 
 
-Schematic::Error Schematic::ParseJson(const std::string& data_str) {
-
-	std::vector<Block> blocks_raw;
-	std::vector<ConnectionRaw> connections_raw;
+namespace {
 
-	// parse json string
+enum class SchematicJsonCtx { ROOT, SKIP, DOCUMENT, BLOCKS, CONNECTIONS, TASKS, BLOCK, CONNECTION, TASK, POS, PARAMS };
 
-	//                                          // just to make things simple in future
-	boost::json::parse_options parse_opt;       // 
-	parse_opt.allow_comments = true;			// 1) allow comments in json
-	parse_opt.allow_trailing_commas = true;     // 2) allow trailing commas
 
-	std::error_code err;
-	boost::json::value js = boost::json::parse(data_str, err, {}, parse_opt);
+// Streaming loader of json schematic file. Blocks and connections are stored directly into 
+// output vectors. First error of blocks/connections list is remembered and errors are reported 
+// in the same order as fields were checked by DOM based loader (id, pos, name, params / src, 
+// src_pin, dst, dst_pin), independently of order of fields in file.
+class SchematicJsonHandler: public JsonSax::Handler<SchematicJsonHandler, SchematicJsonCtx> {
 
-	if (err) return Error::JSON_PARSING_ERROR;
+	using Ctx = SchematicJsonCtx;
+	using Error = Schematic::Error;
 
-	if (!js.is_object()) return Error::JSON_NOT_AN_OBJECT;
+	std::vector<Schematic::Block>* blocks_raw;
+	std::vector<Schematic::ConnectionRaw>* connections_raw;
+	std::vector<Schematic::Task>* tasks_raw;
 
-	auto js_obj = js.as_object();
+	bool is_object = false;
+	bool has_blocks = false;
+	bool has_connections = false;
+	Error blocks_error = Error::OK;
+	Error connections_error = Error::OK;
+	Error tasks_error = Error::OK;
 
-	// blocks 
-	if (auto js_blocks = js_obj.if_contains("blocks")) {
+	// block being parsed
+	Schematic::Block block;
+	Error id_error, pos_error, name_error, params_error, task_error;
+	int pos_count;
+	bool pos_valid;
 
-		if (auto js_blocks_list = js_blocks->if_array()) {
+	// connection being parsed
+	Schematic::ConnectionRaw conn;
+	Error conn_errors[4];
 
-			for (int i = 0; i < js_blocks_list->size(); i++) {
+	// task being parsed
+	Schematic::Task task;
+	bool task_valid;
 
-				Block block;
-				Error e = ParseJsonBlock(js_blocks_list->at(i), &block);
-				if (e != Error::OK) return e;
-				blocks_raw.push_back(block);
-			}
+	static constexpr const char* conn_fields[4] = {"src", "src_pin", "dst", "dst_pin"};
+	static constexpr Error conn_field_errors[4] = {
+		Error::JSON_CONNECTION_INVALID_SRC, Error::JSON_CONNECTION_INVALID_SRCPIN,
+		Error::JSON_CONNECTION_INVALID_DST, Error::JSON_CONNECTION_INVALID_DSTPIN
+	};
 
-		}
-		else { return Error::JSON_BLOCKS_FIELD_NOT_ARRAY; }
+	static void SetError(Error* list_error, Error e){
+		if(*list_error == Error::OK) *list_error = e;
+	}
 
+	int ConnectionField(){
+		for(int i = 0; i < 4; i++)
+			if(key == conn_fields[i]) return i;
+		return -1;
 	}
-	else { return Error::JSON_MISSING_BLOCKS_FIELD; }
 
+	int* ConnectionValue(int field){
+		switch(field){
+		case 0: return &conn.src;
+		case 1: return &conn.src_pin;
+		case 2: return &conn.dst;
+		default: return &conn.dst_pin;
+		}
+	}
 
-	// connections
-	if (auto js_connections = js_obj.if_contains("connections")) {
+	void StartBlock(){
+		block = Schematic::Block();
+		id_error = Error::JSON_BLOCK_MISSING_ID;
+		pos_error = Error::JSON_BLOCK_MISSING_POS;
+		name_error = Error::JSON_BLOCK_MISSING_NAME;
+		params_error = Error::OK; // params are optional
+		task_error = Error::OK;   // task is optional
+	}
 
-		if (auto js_connections_list = js_connections->if_array()) {
+	void FinishBlock(){
+		for(Error e: {id_error, pos_error, name_error, params_error, task_error}){
+			if(e != Error::OK){
+				SetError(&blocks_error, e);
+				return;
+			}
+		}
+		if(blocks_error == Error::OK) blocks_raw->push_back(std::move(block));
+	}
 
-			for (int i = 0; i < js_connections_list->size(); i++) {
+	void StartConnection(){
+		conn = Schematic::ConnectionRaw();
+		for(auto& e: conn_errors) e = Error::OK; // missing fields are caught by IsValid()
+	}
 
-				ConnectionRaw conn;
-				Error e = ParseJsonConnection(js_connections_list->at(i), &conn);
-				if (e != Error::OK) return e;
-				connections_raw.push_back(conn);
+	void FinishConnection(){
+		for(Error e: conn_errors){
+			if(e != Error::OK){
+				SetError(&connections_error, e);
+				return;
 			}
+		}
+		if(!conn.IsValid()){
+			SetError(&connections_error, Error::JSON_CONNECTION_IS_INVALID);
+			return;
+		}
+		if(connections_error == Error::OK) connections_raw->push_back(conn);
+	}
 
+	void StartTask(){
+		task = Schematic::Task();
+		task_valid = true;
+	}
+
+	void FinishTask(){
+		if(!task_valid || !task.IsValid()){
+			SetError(&tasks_error, Error::JSON_TASK_IS_INVALID);
+			return;
 		}
-		else { return Error::JSON_CONNECTIONS_FIELD_NOT_ARRAY; }
+		if(tasks_error == Error::OK) tasks_raw->push_back(std::move(task));
+	}
 
+	// "blocks", "connections" or "tasks" field found in document, later field with same name replaces previous
+	void ListField(bool is_array){
+		if(key == "blocks"){
+			has_blocks = true;
+			blocks_raw->clear();
+			blocks_error = is_array ? Error::OK : Error::JSON_BLOCKS_FIELD_NOT_ARRAY;
+		}else if(key == "connections"){
+			has_connections = true;
+			connections_raw->clear();
+			connections_error = is_array ? Error::OK : Error::JSON_CONNECTIONS_FIELD_NOT_ARRAY;
+		}else if(key == "tasks"){
+			tasks_raw->clear();
+			tasks_error = is_array ? Error::OK : Error::JSON_TASKS_FIELD_NOT_ARRAY;
+		}
 	}
-	else { return Error::JSON_MISSING_CONNECTIONS_FIELD; }
 
+public:
 
+	SchematicJsonHandler(std::vector<Schematic::Block>* _blocks_raw, std::vector<Schematic::ConnectionRaw>* _connections_raw, std::vector<Schematic::Task>* _tasks_raw)
+		: blocks_raw(_blocks_raw), connections_raw(_connections_raw), tasks_raw(_tasks_raw) {}
 
 
-	blocks.clear();
-	connetions.clear();
+	Ctx Enter(Ctx parent, JsonSax::Kind kind){
+		const bool is_array = kind == JsonSax::Kind::ARRAY;
 
-	// convert blocks to valid representation
-	for (const auto& block_raw : blocks_raw) {
-		blocks.push_back(std::make_shared<Block>(block_raw));
-	}
+		switch(parent){
+		case Ctx::ROOT:
+			is_object = !is_array;
+			return is_array ? Ctx::SKIP : Ctx::DOCUMENT;
 
-	// convert connectons to valid internal representation
-	int conn_id = 1;
-	for (const auto& conn_raw : connections_raw) {
+		case Ctx::DOCUMENT:
+			ListField(is_array);
+			if(is_array && key == "blocks") return Ctx::BLOCKS;
+			if(is_array && key == "connections") return Ctx::CONNECTIONS;
+			if(is_array && key == "tasks") return Ctx::TASKS;
+			return Ctx::SKIP;
+
+		case Ctx::BLOCKS:
+			if(is_array){
+				SetError(&blocks_error, Error::JSON_BLOCK_NOT_AN_OBJECT);
+				return Ctx::SKIP;
+			}
+			StartBlock();
+			return Ctx::BLOCK;
 
-		std::weak_ptr<Block> src_ptr;
-		std::weak_ptr<Block> dst_ptr;
+		case Ctx::CONNECTIONS:
+			if(is_array){
+				SetError(&connections_error, Error::JSON_CONNECTION_NOT_AN_OBJECT);
+				return Ctx::SKIP;
+			}
+			StartConnection();
+			return Ctx::CONNECTION;
 
-		// find blocks with specified indexes
-		for (const auto& block_ptr : blocks) {
-			if (conn_raw.src == block_ptr.get()->id) src_ptr = block_ptr;
-			if (conn_raw.dst == block_ptr.get()->id) dst_ptr = block_ptr;
+		case Ctx::TASKS:
+			if(is_array){
+				SetError(&tasks_error, Error::JSON_TASK_NOT_AN_OBJECT);
+				return Ctx::SKIP;
+			}
+			StartTask();
+			return Ctx::TASK;
+
+		case Ctx::BLOCK:
+			if(key == "id") id_error = Error::JSON_BLOCK_INVALID_ID;
+			else if(key == "name") name_error = Error::JSON_BLOCK_NAME_NOT_STRING;
+			else if(key == "pos"){
+				if(!is_array){
+					pos_error = Error::JSON_BLOCK_POS_NOT_ARRAY;
+					return Ctx::SKIP;
+				}
+				pos_error = Error::OK;
+				pos_count = 0;
+				pos_valid = true;
+				return Ctx::POS;
+			}
+			else if(key == "params"){
+				if(!is_array){
+					params_error = Error::JSON_BLOCK_PARAMS_NOT_ARRAY;
+					return Ctx::SKIP;
+				}
+				params_error = Error::OK;
+				block.parameters.clear();
+				return Ctx::PARAMS;
+			}
+			else if(key == "task") task_error = Error::JSON_BLOCK_INVALID_TASK;
+			return Ctx::SKIP;
+
+		case Ctx::CONNECTION:{
+			int field = ConnectionField();
+			if(field >= 0) conn_errors[field] = conn_field_errors[field];
+			return Ctx::SKIP;
 		}
 
-		connetions.emplace_back(conn_id++, src_ptr, conn_raw.src_pin, dst_ptr, conn_raw.dst_pin);
+		case Ctx::TASK:
+			task_valid = false; // every field of task is a single value
+			return Ctx::SKIP;
 
-	}
+		case Ctx::POS:
+			pos_valid = false;
+			pos_count++;
+			return Ctx::SKIP;
 
+		case Ctx::PARAMS:
+			params_error = Error::JSON_BLOCK_PARAMETER_INVALID_TYPE;
+			return Ctx::SKIP;
 
-	// find id for next block/connection
-	for(auto& b: blocks){
-		next_block_id = next_block_id > b->id ? next_block_id : b->id; // next_block_id = max(next_block_id, id);
+		default:
+			return Ctx::SKIP;
+		}
 	}
-	next_block_id++;
 
-	for(auto& c: connetions){
-		next_connection_id = next_connection_id  > c.id ? next_connection_id  : c.id; // next_block_id = max(next_block_id, id);
+
+	void Leave(Ctx ctx){
+		switch(ctx){
+		case Ctx::BLOCK: FinishBlock(); break;
+		case Ctx::CONNECTION: FinishConnection(); break;
+		case Ctx::TASK: FinishTask(); break;
+		case Ctx::POS:
+			if(!pos_valid || pos_count != 2) pos_error = Error::JSON_BLOCK_INVALID_POS;
+			break;
+		default: break;
+		}
 	}
-	next_connection_id++;
 
-	return Error::OK;
-}
 
+	void OnValue(Ctx parent, const JsonSax::Value& v){
+		switch(parent){
+		case Ctx::DOCUMENT: 
+			ListField(false); 
+			break;
 
+		case Ctx::BLOCKS: 
+			SetError(&blocks_error, Error::JSON_BLOCK_NOT_AN_OBJECT); 
+			break;
 
+		case Ctx::CONNECTIONS: 
+			SetError(&connections_error, Error::JSON_CONNECTION_NOT_AN_OBJECT); 
+			break;
 
-Schematic::Error Schematic::ParseJsonBlock(const boost::json::value& js, Block* block) {
-	if (!js.is_object()) return Error::JSON_BLOCK_NOT_AN_OBJECT;
+		case Ctx::TASKS: 
+			SetError(&tasks_error, Error::JSON_TASK_NOT_AN_OBJECT); 
+			break;
 
-	auto js_obj = js.as_object();
+		case Ctx::BLOCK:
+			if(key == "id"){
+				id_error = v.IsInt() ? Error::OK : Error::JSON_BLOCK_INVALID_ID;
+				if(v.IsInt()) block.id = v.AsInt();
+			}else if(key == "name"){
+				name_error = v.kind == JsonSax::Kind::STRING ? Error::OK : Error::JSON_BLOCK_NAME_NOT_STRING;
+				if(v.kind == JsonSax::Kind::STRING) block.full_name.assign(v.string);
+			}
+			else if(key == "pos") pos_error = Error::JSON_BLOCK_POS_NOT_ARRAY;
+			else if(key == "params") params_error = Error::JSON_BLOCK_PARAMS_NOT_ARRAY;
+			else if(key == "task"){
+				task_error = v.IsInt() && v.AsInt() >= 0 ? Error::OK : Error::JSON_BLOCK_INVALID_TASK;
+				if(v.IsInt()) block.task = v.AsInt();
+			}
+			break;
+
+		case Ctx::CONNECTION:{
+			int field = ConnectionField();
+			if(field < 0) break;
+			conn_errors[field] = v.IsInt() ? Error::OK : conn_field_errors[field];
+			if(v.IsInt()) *ConnectionValue(field) = v.AsInt();
+			break;
+		}
 
-	auto IsInt =
-		[](const boost::json::value& js) -> bool
-	{
-		return js.is_int64() || js.is_uint64();
-	};
+		case Ctx::TASK:
+			if(key == "name"){
+				if(v.kind == JsonSax::Kind::STRING) task.name.assign(v.string);
+				else task_valid = false;
+			}else if(key == "period" || key == "offset" || key == "priority"){
+				if(!v.IsInt()){
+					task_valid = false;
+					break;
+				}
+				if(key == "period") task.period = v.AsInt();
+				else if(key == "offset") task.offset = v.AsInt();
+				else task.priority = v.AsInt();
+			}
+			break;
+
+		case Ctx::POS:
+			if(!v.IsInt()) pos_valid = false;
+			else if(pos_count == 0) block.pos.x = v.AsInt();
+			else if(pos_count == 1) block.pos.y = v.AsInt();
+			pos_count++;
+			break;
+
+		case Ctx::PARAMS:
+			switch(v.kind){
+			case JsonSax::Kind::NUL:    block.parameters.emplace_back<std::monostate>(std::monostate()); break;
+			case JsonSax::Kind::BOOL:   block.parameters.emplace_back(v.boolean); break;
+			case JsonSax::Kind::INT64:  block.parameters.emplace_back(v.int64); break;
+			case JsonSax::Kind::UINT64: block.parameters.emplace_back((int64_t)v.uint64); break;
+			case JsonSax::Kind::DOUBLE: block.parameters.emplace_back(v.real); break;
+			case JsonSax::Kind::STRING: block.parameters.emplace_back(std::string(v.string)); break;
+			default: break;
+			}
+			break;
 
+		default:
+			break;
+		}
+	}
 
-	auto GetInt =
-		[](const boost::json::value& js) -> int
-	{
-		if (js.is_int64()) return js.as_int64();
-		if (js.is_uint64()) return js.as_uint64();
-		return 0;
-	};
 
+	Error Result(){
+		if(!is_object) return Error::JSON_NOT_AN_OBJECT;
 
-	// get id
-	if (auto js_id = js_obj.if_contains("id")) {
-		if (uint64_t* num = js_id->if_uint64())
-			block->id = *num;
-		else if (int64_t* num = js_id->if_int64())
-			block->id = *num;
-		else
-			return Error::JSON_BLOCK_INVALID_ID;
-	}
-	else { return Error::JSON_BLOCK_MISSING_ID; }
+		if(!has_blocks) return Error::JSON_MISSING_BLOCKS_FIELD;
+		if(blocks_error != Error::OK) return blocks_error;
 
-	// get pos
-	if (auto js_pos = js_obj.if_contains("pos")) {
-		if (auto js_pos_arr = js_pos->if_array()) {
-			if (js_pos_arr->size() != 2)
-				return Error::JSON_BLOCK_INVALID_POS;
+		if(!has_connections) return Error::JSON_MISSING_CONNECTIONS_FIELD;
+		if(connections_error != Error::OK) return connections_error;
 
-			if (!IsInt(js_pos_arr->at(0))) return Error::JSON_BLOCK_INVALID_POS;
-			if (!IsInt(js_pos_arr->at(1))) return Error::JSON_BLOCK_INVALID_POS;
+		if(tasks_error != Error::OK) return tasks_error; // tasks are optional
 
-			block->pos.x = GetInt(js_pos_arr->at(0));
-			block->pos.y = GetInt(js_pos_arr->at(1));
-		}
-		else return Error::JSON_BLOCK_POS_NOT_ARRAY;
+		return Error::OK;
 	}
-	else return Error::JSON_BLOCK_MISSING_POS;
+};
 
-	// get src
-	if (auto js_name = js_obj.if_contains("name")) {
-		if (auto js_name_str = js_name->if_string()) {
-			block->full_name = std::string(js_name_str->begin(), js_name_str->end());
-		}
-		else return Error::JSON_BLOCK_NAME_NOT_STRING;
-	}
-	else return Error::JSON_BLOCK_MISSING_NAME;
+}
 
-	// get params
-	// dont throw error if missing
-	if (auto js_params = js_obj.if_contains("params")){
-		if(auto js_params_arr = js_params->if_array()){
-			
-			for(auto& js_par: *js_params_arr){
-
-				if(js_par.is_null())
-					block->parameters.emplace_back<std::monostate>(std::monostate());
-				else if(js_par.is_bool())
-					block->parameters.emplace_back(js_par.as_bool());
-				else if(js_par.is_int64())
-					block->parameters.emplace_back(js_par.as_int64());
-				else if(js_par.is_uint64())
-					block->parameters.emplace_back((int64_t)js_par.as_uint64());
-				else if(js_par.is_double())
-					block->parameters.emplace_back(js_par.as_double());
-				else if(js_par.is_string())
-					block->parameters.emplace_back(js_par.as_string().c_str());
-				else
-					return Error::JSON_BLOCK_PARAMETER_INVALID_TYPE; 
-					
-			}
 
-		}else return Error::JSON_BLOCK_PARAMS_NOT_ARRAY;
-	}
+Schematic::Error Schematic::ParseJson(const std::string& data_str) {
 
-	return Error::OK;
-}
+	std::vector<Block> blocks_raw;
+	std::vector<ConnectionRaw> connections_raw;
+	std::vector<Task> tasks_raw;
 
+	// parse json string, blocks and connections are filled directly by streaming parser
+	boost::json::basic_parser<SchematicJsonHandler> parser(JsonSax::Options(), &blocks_raw, &connections_raw, &tasks_raw);
 
+	if (!JsonSax::Parse(parser, data_str)) return Error::JSON_PARSING_ERROR;
 
+	Error err = parser.handler().Result();
+	if (err != Error::OK) return err;
 
-Schematic::Error Schematic::ParseJsonConnection(const boost::json::value& js, ConnectionRaw* conn) {
-	if (!js.is_object())
-		return Error::JSON_CONNECTION_NOT_AN_OBJECT;
+	// tasks may follow blocks in file, so indexes are checked after whole document is read
+	if (tasks_raw.empty()) tasks_raw.push_back(Task{"main"});
+	for (const auto& block_raw : blocks_raw)
+		if (block_raw.task >= tasks_raw.size()) return Error::JSON_BLOCK_INVALID_TASK;
 
-	auto js_obj = js.as_object();
+	tasks = std::move(tasks_raw);
 
-	auto IsInt =
-		[](const boost::json::value* js) -> bool
-	{
-		return js->is_int64() || js->is_uint64();
-	};
 
+	blocks.clear();
+	connetions.clear();
+	block_index.clear();
+	connection_index.clear();
+	links_index.clear();
 
-	auto GetInt =
-		[](const boost::json::value* js) -> int
-	{
-		if (js->is_int64()) return js->as_int64();
-		if (js->is_uint64()) return js->as_uint64();
-		return -1;
-	};
+	block_index.reserve(blocks_raw.size());
+	connection_index.reserve(connections_raw.size());
+	links_index.reserve(blocks_raw.size());
 
-	
-	// src
-	if (auto js_num = js_obj.if_contains("src")) {
-		if (IsInt(js_num)) conn->src = GetInt(js_num);
-		else return Error::JSON_CONNECTION_INVALID_SRC;
+	// convert blocks to valid representation
+	for (auto& block_raw : blocks_raw) {
+		blocks.push_back(std::make_shared<Block>(std::move(block_raw)));
+		block_index[blocks.back()->id] = blocks.back();
 	}
 
-	// src_pin
-	if (auto js_num = js_obj.if_contains("src_pin")) {
-		if (IsInt(js_num)) conn->src_pin = GetInt(js_num);
-		else return Error::JSON_CONNECTION_INVALID_SRCPIN;
-	}
+	// convert connectons to valid internal representation
+	int conn_id = 1;
+	for (const auto& conn_raw : connections_raw) {
 
-	// src
-	if (auto js_num = js_obj.if_contains("dst")) {
-		if (IsInt(js_num)) conn->dst = GetInt(js_num);
-		else return Error::JSON_CONNECTION_INVALID_DST;
-	}
+		// find blocks with specified indexes
+		std::weak_ptr<Block> src_ptr = FindBlock(conn_raw.src);
+		std::weak_ptr<Block> dst_ptr = FindBlock(conn_raw.dst);
+
+		connetions.emplace_back(conn_id++, src_ptr, conn_raw.src_pin, dst_ptr, conn_raw.dst_pin);
+		IndexConnection(std::prev(connetions.end()));
 
-	// src_pin
-	if (auto js_num = js_obj.if_contains("dst_pin")) {
-		if (IsInt(js_num)) conn->dst_pin = GetInt(js_num);
-		else return Error::JSON_CONNECTION_INVALID_DSTPIN;
 	}
 
-	if (!conn->IsValid())
-		return Error::JSON_CONNECTION_IS_INVALID;
+	FinishLoading();
 
 	return Error::OK;
+}
+
+
+void Schematic::FinishLoading() {
+
+	// order from file is not checked
+	RebuildOrderIndex();
+	order_dirty = true;
+
+
+	// find id for next block/connection
+	for(auto& b: blocks){
+		next_block_id = next_block_id > b->id ? next_block_id : b->id; // next_block_id = max(next_block_id, id);
+	}
+	next_block_id++;
 
+	for(auto& c: connetions){
+		next_connection_id = next_connection_id  > c.id ? next_connection_id  : c.id; // next_block_id = max(next_block_id, id);
+	}
+	next_connection_id++;
 }
 
 
 
+
 bool Schematic::CodeExtractSection(const std::string& code, std::string* result, const std::string& marker){
 
 	std::string begin_marker = "\n//////****** begin " + marker + " ******//////\n";
@@ -386,373 +822,1030 @@ bool Schematic::CodeExtractSection(const std::string& code, std::string* result,
 }
 
 
+// process image shared by generated main() and block classes
+// IO module state is read once when cycle starts and written once before it ends,
+// blocks work only with this copy (see std 'io.library').
+// time is also read once per cycle, every block of the cycle sees the same timestamp and
+// timers of all blocks live in one hashed wheel (see std 'time.library'): a cycle costs
+// one step per elapsed millisecond plus expiring timers, armed or idle timers cost nothing.
+static constexpr const char* PROCESS_IMAGE_CODE =
+	"#include <chrono>\n"
+	"\n"
+	"struct PLC_Timer {\n"
+	"    int64_t deadline = 0;\n"
+	"    bool armed = false;\n"
+	"    bool expired = false; // set by wheel when deadline is reached, cleared by Start/Stop\n"
+	"    PLC_Timer* prev = nullptr;\n"
+	"    PLC_Timer* next = nullptr;\n"
+	"};\n"
+	"\n"
+	"class PLC_TimerWheel {\n"
+	"public:\n"
+	"    static constexpr int SLOTS = 1024; // 1 ms per slot\n"
+	"\n"
+	"    int64_t Now() const { return now; }\n"
+	"\n"
+	"    // timer expires 'delay_ms' after cycle timestamp, running timer is restarted\n"
+	"    void Start(PLC_Timer& t, int64_t delay_ms){\n"
+	"        Stop(t);\n"
+	"        t.deadline = now + delay_ms;\n"
+	"        if(delay_ms <= 0){\n"
+	"            t.expired = true;\n"
+	"            return;\n"
+	"        }\n"
+	"        PLC_Timer*& head = slots[t.deadline % SLOTS];\n"
+	"        t.armed = true;\n"
+	"        t.prev = nullptr;\n"
+	"        t.next = head;\n"
+	"        if(head) head->prev = &t;\n"
+	"        head = &t;\n"
+	"    }\n"
+	"\n"
+	"    void StartAt(PLC_Timer& t, int64_t deadline){ Start(t, deadline - now); }\n"
+	"\n"
+	"    void Stop(PLC_Timer& t){\n"
+	"        t.expired = false;\n"
+	"        if(t.armed) Unlink(t);\n"
+	"    }\n"
+	"\n"
+	"    // called once per cycle, visits slots of elapsed milliseconds (every slot at most once)\n"
+	"    void Advance(int64_t time_ms){\n"
+	"        now = time_ms;\n"
+	"        int64_t first = tick + 1 > now - SLOTS + 1 ? tick + 1 : now - SLOTS + 1;\n"
+	"        for(int64_t ms = first; ms <= now; ms++){\n"
+	"            for(PLC_Timer* t = slots[ms % SLOTS]; t;){\n"
+	"                PLC_Timer* next = t->next;\n"
+	"                if(t->deadline <= now){\n"
+	"                    Unlink(*t);\n"
+	"                    t->expired = true;\n"
+	"                }\n"
+	"                t = next;\n"
+	"            }\n"
+	"        }\n"
+	"        tick = now;\n"
+	"    }\n"
+	"\n"
+	"private:\n"
+	"    PLC_Timer* slots[SLOTS] = {};\n"
+	"    int64_t now = 0;\n"
+	"    int64_t tick = 0;\n"
+	"\n"
+	"    void Unlink(PLC_Timer& t){\n"
+	"        if(t.prev) t.prev->next = t.next;\n"
+	"        else slots[t.deadline % SLOTS] = t.next;\n"
+	"        if(t.next) t.next->prev = t.prev;\n"
+	"        t.prev = t.next = nullptr;\n"
+	"        t.armed = false;\n"
+	"    }\n"
+	"};\n"
+	"\n"
+	"struct PLC_ProcessImage {\n"
+	"    PLC::IOmoduleData io;\n"
+	"    bool outputs_changed = false; // set by blocks writing outputs, image is flushed only when set\n"
+	"    int64_t time_ms = 0;          // cycle timestamp, steady clock in milliseconds\n"
+	"    PLC_TimerWheel timers;        // advanced to time_ms when cycle starts\n"
+	"\n"
+	"    void UpdateTime(){\n"
+	"        time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();\n"
+	"        timers.Advance(time_ms);\n"
+	"    }\n"
+	"};\n"
+	"\n"
+	"inline PLC_ProcessImage process_image;\n";
+
+
+// input of block class in signal table mode, reference to table slot or constant default slot
+// input is never null, so 'input ? *input : false' in block code compiles to plain read
+static constexpr const char* SIGNAL_INPUT_CODE =
+	"template<class T>\n"
+	"struct PLC_Input {\n"
+	"    const T& value;\n"
+	"    constexpr explicit operator bool() const { return true; }\n"
+	"    constexpr const T& operator*() const { return value; }\n"
+	"    constexpr const T* operator->() const { return &value; }\n"
+	"};\n";
+
+
+// threads updating parts of parallel phases (see schematic_parallel.cpp)
+// main thread runs part of worker 0 and waits until other workers finish theirs
+// waiting threads spin shortly (next phase usually starts within microseconds),
+// then sleep on condition variable, so workers don't use CPU between cycles
+static constexpr const char* WORKER_POOL_CODE =
+	"#include <atomic>\n"
+	"#include <thread>\n"
+	"#include <mutex>\n"
+	"#include <condition_variable>\n"
+	"#include <functional>\n"
+	"\n"
+	"template<int WORKERS>\n"
+	"class PLC_WorkerPool {\n"
+	"public:\n"
+	"    explicit PLC_WorkerPool(std::function<void(int)> func): part(std::move(func)){\n"
+	"        // workers without own core would only slow the cycle down\n"
+	"        const unsigned cores = std::thread::hardware_concurrency();\n"
+	"        serial = cores != 0 && cores < WORKERS;\n"
+	"        if(serial) return;\n"
+	"\n"
+	"        for(int w = 1; w < WORKERS; w++)\n"
+	"            threads[w - 1] = std::thread([this, w](){ Work(w); });\n"
+	"    }\n"
+	"\n"
+	"    ~PLC_WorkerPool(){\n"
+	"        stop = true;\n"
+	"        generation.fetch_add(1, std::memory_order_release);\n"
+	"        Notify(start_cv);\n"
+	"        for(auto& t: threads) if(t.joinable()) t.join();\n"
+	"    }\n"
+	"\n"
+	"    // worker w runs part 'first + w', returns when all parts are finished\n"
+	"    void Run(int first){\n"
+	"        if(serial){\n"
+	"            for(int w = 0; w < WORKERS; w++) part(first + w);\n"
+	"            return;\n"
+	"        }\n"
+	"        first_part = first;\n"
+	"        done.store(0, std::memory_order_relaxed);\n"
+	"        generation.fetch_add(1, std::memory_order_release);\n"
+	"        Notify(start_cv);\n"
+	"        part(first);\n"
+	"        Wait(done_cv, [this](){ return done.load(std::memory_order_acquire) == WORKERS - 1; });\n"
+	"    }\n"
+	"\n"
+	"private:\n"
+	"    static constexpr int SPIN_LIMIT = 2000;\n"
+	"\n"
+	"    std::function<void(int)> part;\n"
+	"    std::thread threads[WORKERS - 1];\n"
+	"    std::atomic<uint32_t> generation{0};\n"
+	"    std::atomic<int> done{0};\n"
+	"    std::mutex mutex;\n"
+	"    std::condition_variable start_cv;\n"
+	"    std::condition_variable done_cv;\n"
+	"    int first_part = 0;\n"
+	"    bool stop = false;\n"
+	"    bool serial = false;\n"
+	"\n"
+	"    // taking the mutex orders the notify after the check of every sleeping thread\n"
+	"    void Notify(std::condition_variable& cv){\n"
+	"        { std::lock_guard<std::mutex> lock(mutex); }\n"
+	"        cv.notify_all();\n"
+	"    }\n"
+	"\n"
+	"    template<class Pred>\n"
+	"    void Wait(std::condition_variable& cv, Pred ready){\n"
+	"        for(int spins = 0; spins < SPIN_LIMIT; spins++) if(ready()) return;\n"
+	"        std::unique_lock<std::mutex> lock(mutex);\n"
+	"        cv.wait(lock, ready);\n"
+	"    }\n"
+	"\n"
+	"    void Work(int w){\n"
+	"        uint32_t seen = 0;\n"
+	"        while(true){\n"
+	"            Wait(start_cv, [this, seen](){ return generation.load(std::memory_order_acquire) != seen; });\n"
+	"            seen = generation.load(std::memory_order_acquire);\n"
+	"            if(stop) return;\n"
+	"            part(first_part + w);\n"
+	"            if(done.fetch_add(1, std::memory_order_acq_rel) == WORKERS - 2) Notify(done_cv);\n"
+	"        }\n"
+	"    }\n"
+	"};\n";
+
+
 std::string Schematic::BuildToCPP(){
+	CodeWriter out;
+	BuildToCPP(out, false);
+	return out.Release();
+}
+
+
+void Schematic::BuildToCPP(std::ostream& sink){
+	CodeWriter out(0, &sink);
+	BuildToCPP(out, false);
+	out.Flush();
+}
+
+
+Schematic::Error Schematic::BuildToCPPFiles(std::vector<CodeFile>* files){
+	files->clear();
+
+	CodeWriter main_file;
+	BuildToCPP(main_file, true);
+	files->push_back({"file1.cpp", main_file.Release()});
+	CodeWriter process_image_file;
+	process_image_file << "#pragma once\n#include <PLC_app.hpp>\n\n" << PROCESS_IMAGE_CODE;
+	WriteMemory(process_image_file);
+	if(code_options.signal_table) process_image_file << '\n' << SIGNAL_INPUT_CODE;
+	files->push_back({"process_image.hpp", process_image_file.Release()});
+
+	// file1.cpp includes header of every class, missing one would fail only on PLC
+	for(const auto& block_lib: UsedLibraryBlocks()){
+		const BlockClassCode* class_code = GetBlockClass(block_lib);
+		if(!class_code){
+			files->clear();
+			return Error::BLOCK_CODE_NOT_GENERATED;
+		}
+
+		files->push_back({class_code->name + ".hpp", class_code->header});
+		if(!class_code->source.empty())
+			files->push_back({class_code->name + ".cpp", class_code->source});
+	}
+
+	return Error::OK;
+}
+
+
+std::vector<std::shared_ptr<BlockData>> Schematic::UsedLibraryBlocks(){
 
-	std::list<std::string> blocks_cpp_classes;
-	std::list<std::shared_ptr<BlockData>> lib_blocks;
+	std::vector<std::shared_ptr<BlockData>> lib_blocks;
 
-	// step 1 - create list of unique library blocks 
+	// create list of unique library blocks (in order of first use)
 	{
-		// 1.1 - list all library blocks 
+		std::unordered_set<const BlockData*> seen_blocks;
+		std::unordered_set<std::string> seen_names;
+
 		for(const auto& block: blocks) {
+			if(!code_plan.IsEmitted(block->id)) continue;
 			auto lib_block = block->lib_block.lock(); 
 
-
 			if(lib_block){
-				// check for duplicates
-				std::string full_name1 = lib_block->FullName();
-				bool found_duplicate = false;
-
-				for (auto b : lib_blocks) {
-					std::string full_name2 = b->FullName();
-					if (full_name2 == full_name1) {
-						found_duplicate = true;
-						break;
-					}
-				}
+				if(!seen_blocks.insert(lib_block.get()).second) continue;
 
-				if (!found_duplicate)
+				// different library objects might still share the same name
+				if(seen_names.insert(lib_block->FullName()).second)
 					lib_blocks.push_back(lib_block);
 
 			}else{
 				//TODO: handle this error later;
 			}
 		}
-
-		// 1.2 - remove duplicates
-		lib_blocks.unique();
 	}
 
-	std::vector<std::string> block_class_names;
 
-	// step 2 - read and process blocks code
-	for(const auto& block_lib: lib_blocks){
-		
-		std::string full_name =  block_lib->FullName();
-		std::string code;
+	return lib_blocks;
+}
 
-		blocks_cpp_classes.push_back("");
-		
-		{// 2.1 - read code from file
-			BlockData::Error err = block_lib->ReadCode(&code);
-			if(err != BlockData::Error::OK) continue; //TODO: handle this error later;
 
-			// convert '\r' -> '\n' to prevent errors
-			boost::replace_all(code, "\r", "\n");
-		}
+void Schematic::BuildToCPP(CodeWriter& out, bool split_files){
 
-		{// 2.2 - process code and replace name with full_name;
+	// step 1 - optimization pass and list of unique library blocks
+	OptimizeCode();
+	PlanTasks();
+	PlanMemory();
+	PlanLogicNetworks();
+	PlanChangeDriven();
+	PlanParallel();
+	std::vector<std::shared_ptr<BlockData>> lib_blocks = UsedLibraryBlocks();
 
-			std::string user_include;
-			std::string user_functions;
-			std::string user_init_func_body;
-			std::string user_update_func_body;
+	out << 
+	"#include <string>\n"
+	"#include <inttypes.h>\n"
+	"#include <PLC_app.hpp>"
+	"\n\n"
+	"// 	process image"
+	"\n\n";
 
-			// extract code
-			CodeExtractSection(code, &user_include, "includes");
-			CodeExtractSection(code, &user_functions, "functions");
-			CodeExtractSection(code, &user_init_func_body, "init");
-			CodeExtractSection(code, &user_update_func_body, "update");
+	if(split_files){
+		out << "#include \"process_image.hpp\"\n";
+	}else{
+		out << PROCESS_IMAGE_CODE;
+		WriteMemory(out);
+		if(code_options.signal_table) out << '\n' << SIGNAL_INPUT_CODE;
+	}
 
-			// replace '/' and '\' with '__'
-			std::string full_name_processed = full_name;
-			boost::replace_all(full_name_processed, "\\", "__");
-			boost::replace_all(full_name_processed, "/", "__");
+	if(!code_plan.phases.empty())
+		out << 
+		"\n\n"
+		"// 	worker pool"
+		"\n\n"
+		<< WORKER_POOL_CODE;
 
+	out << 
+	"\n\n"
+	"// 	block classes"
+	"\n\n";
 
-			// class prolog
-			std::string r_class_prolog;
-			{
-				r_class_prolog = 
-					"\n\nclass " + full_name_processed + "_block{ \n"
-					"public: \n";
-				
-				auto inputs = block_lib->Inputs();
-				for(int i = 0; i < inputs.size(); i++){
-					r_class_prolog +=
-					"    const " + inputs[i].type + "* input" + std::to_string(i) + ";\n";
-				}
+	// step 2 - read and process blocks code
+	bool uses_process_image = false;
+	bool uses_time = false;
+	std::unordered_set<const BlockData*> without_init;
+
+	// time blocks use only timestamp and timers, IO image is not read for them
+	auto UsesIO = [](const std::string& code){
+		for(size_t pos = code.find("process_image"); pos != std::string::npos; pos = code.find("process_image", pos + 1))
+			if(code.compare(pos, 18, "process_image.time") != 0) return true;
+		return false;
+	};
 
-				auto parameters = block_lib->Parameters();
-				for(int i = 0; i < parameters.size(); i++){
-					r_class_prolog +=
-					"    " + parameters[i].type + "  parameter" + std::to_string(i) + ";\n";
-				}
+	for(const auto& block_lib: lib_blocks){
+		const BlockClassCode* class_code = GetBlockClass(block_lib);
+		if(class_code && UsesIO(class_code->code)) 
+			uses_process_image = true;
+		if(class_code && class_code->code.find("process_image.time") != std::string::npos) 
+			uses_time = true;
+		if(class_code && !class_code->has_init)
+			without_init.insert(block_lib.get());
+
+		if(class_code && split_files)
+			out << "#include \"" << class_code->name << ".hpp\"";
+		else if(class_code)
+			out << class_code->code;
+		out << '\n';
+	}
 
-				auto outputs = block_lib->Outputs();
-				for(int i = 0; i < outputs.size(); i++){
-					r_class_prolog +=
-					"    " + outputs[i].type + "  output" + std::to_string(i) + ";\n";
-				}
+
+	// class names are shared by all instances of a library block
+	std::unordered_map<const BlockData*, std::string> class_names;
+	for(const auto& block_lib: lib_blocks)
+		class_names.emplace(block_lib.get(), CodeClassName(block_lib->FullName()) + "_block");
+
+	// rough size of everything below, so the buffer grows at most a few times
+	out.Reserve(out.Size() + 4096 + blocks.size() * 256 + connetions.size() * 64);
+
+
+	// inputs connected to folded blocks read these
+	if(!code_report.folded_blocks.empty())
+		out << 
+		"\n\n"
+		"// 	constant signals\n"
+		"\n\n"
+		"static const bool plc_const_false = false;\n"
+		"static const bool plc_const_true = true;\n";
+
+	// parameter values of templated block classes
+	if(code_options.constant_parameters){
+		out << 
+		"\n\n"
+		"// 	constant parameters\n"
+		"\n\n";
+
+		for(const auto& block: blocks){
+			auto lib_block = block->lib_block.lock();
+			if(!lib_block || !code_plan.IsEmitted(block->id) || !HasConstantParameters(lib_block)) continue;
+
+			out << "struct block_" << block->id << "_params {\n";
+			const auto& lib_params = lib_block->Parameters();
+			for(int i = 0; i < lib_params.size(); i++){
+				if(!IsConstantParameterType(lib_params[i].type)) continue;
+				out << "    static constexpr " << lib_params[i].type << " parameter" << i << " = ";
+				WriteParameterValue(out, lib_params[i].type, *block, i);
+				out << '\n';
 			}
+			out << "};\n";
+		}
+	}
 
-			// init function prolog
-			std::string r_init_func_prolog = 
-					"\n" 
-					"    void init(){\n";
+	// step 3 - block instances and connections between them
+	if(code_options.signal_table)
+		BuildSignalTable(out, class_names);
+	else
+		BuildBlockInstances(out, class_names);
 
-			// update function prolog
-			std::string r_update_func_prolog = 
-					"\n"
-					"    }\n"
-					"\n"        
-					"    void update(){\n";
-			
-			// class epilogue
-			std::string r_class_epilog = 
-						"\n"
-						"    }\n"
-						"};\n";
+	out << 
+	"\n\n"
+	"// 	parameters\n"
+	"\n\n";
 
+	// step 4 - setup parameters
+	for(const auto& block: blocks){
 
-			std::string processed_code = 
-			 		  user_include
-					+ r_class_prolog
-					+ user_functions
-					+ r_init_func_prolog
-					+ user_init_func_body
-					+ r_update_func_prolog
-					+ user_update_func_body
-					+ r_class_epilog;
+		auto lib_block = block->lib_block.lock();
+		if(!lib_block || !code_plan.IsEmitted(block->id)) continue;
 
-			blocks_cpp_classes.back() = processed_code;
-			block_class_names.push_back(full_name);
+		const auto& lib_params = lib_block->Parameters();
+		const bool is_template = code_options.constant_parameters && HasConstantParameters(lib_block);
+		
+		for(int i = 0; i < lib_params.size(); i++){
+
+			const std::string& type = lib_params[i].type;
+			if(is_template && IsConstantParameterType(type)) continue; // already set in block_N_params
+
+			out << "    ";
+
+			if(type != "bool" && type != "double" && type != "int64_t" && type != "std::string"){
+				out << '\n'; // unsupported type
+				continue;
+			}
+
+			out << "block_" << block->id << ".parameter" << i << " = ";
+			WriteParameterValue(out, type, *block, i);
+			out << '\n';
 		}
 	}
 
 
-	std::list<std::string> blocks_cpp_objects;
-	std::list<std::string> blocks_cpp_init;
-	std::list<std::string> blocks_cpp_update;
+	out << 
+	"\n\n"
+	"// 	Init blocks\n"
+	"\n\n";
+
+	// timers started in init() count from here
+	if(uses_time)
+		out << "    process_image.UpdateTime();\n";
 
-	// step 3 - create all objects representing blocks + init/update functions
+	// step 5 - init and update calls
 	for(const auto& block: blocks){
+		if(!code_plan.IsEmitted(block->id)) continue;
+
+		auto lib_block = block->lib_block.lock();
+		if(lib_block && without_init.count(lib_block.get())){
+			code_report.blocks_without_init++;
+			continue;
+		}
+		out << "    block_" << block->id << ".init();\n";
+	}
+
+	// initial values of network outputs read outside (nQ starts as true)
+	for(int n = 0; n < code_plan.networks.size(); n++)
+		WriteLogicOutputs(out, n, "    ");
+
+	if(!code_plan.phases.empty())
+		WriteWorkerParts(out);
+
+	if(code_plan.dirty_count)
+		out << 
+		"\n"
+		"    bool plc_dirty[" << code_plan.dirty_count << "];\n"
+		"    for(bool& dirty: plc_dirty) dirty = true; // first cycle updates every block\n";
+
+	if(IsMultiTask())
+		out << "\n    uint64_t plc_cycle = 0; // base cycles since start, selects due tasks\n";
+
+	out << 
+	"\n\n"
+	"    while(true){\n\n"
+	"       if(!PLC::LoopStart()) return 0;\n";
+
+	// single IO read and timestamp per cycle, only when some block works with them
+	if(uses_process_image)
+		out << "       process_image.io = PLC::GetIO();\n";
+	if(uses_time)
+		out << "       process_image.UpdateTime();\n";
+
+	out << 
+	"// 	Update blocks\n"
+	"\n\n";
 
-		std::string class_name = block->GetFullName() + "_block";
-		// replace '/' and '\' with '__'
-		boost::replace_all(class_name, "\\", "__");
-		boost::replace_all(class_name, "/", "__");
+	// due tasks one after another, single task without condition
+	int part = 0;
+	for(int task: code_plan.task_order){
+		const bool conditional = WriteTaskBegin(out, task);
 
-		std::string object_name = "block_" + std::to_string(block->id);
+		if(code_plan.phases.empty()){
+			for(const auto& block: blocks)
+				if(TaskOf(*block) == task) WriteBlockUpdate(out, block->id);
+		}
 
-		std::string object = class_name + " " + object_name + ";";
-		std::string init_call =  object_name + ".init();";
-		std::string update_call = object_name + ".update();";
+		// serial phases in place, parallel phases by worker pool
+		for(const auto& phase: code_plan.phases){
+			if(phase.task != task) continue;
+			if(!phase.parallel){
+				for(int id: phase.parts[0]) WriteBlockUpdate(out, id);
+				continue;
+			}
+			out << "        plc_workers.Run(" << part << ");\n";
+			part += phase.parts.size();
+		}
 
-		blocks_cpp_objects.push_back(object);
-		blocks_cpp_init.push_back(init_call);
-		blocks_cpp_update.push_back(update_call);
+		if(conditional) out << "        }\n";
 	}
 
+	// single IO write per cycle
+	if(uses_process_image)
+		out << 
+		"\n"
+		"       if(process_image.outputs_changed){\n"
+		"           PLC::SetIO(process_image.io);\n"
+		"           process_image.outputs_changed = false;\n"
+		"       }\n";
+
+	out << 
+	"\n"
+	"       PLC::LoopEnd();"
+	"\n";
+
+	if(IsMultiTask())
+		out << "       plc_cycle++;\n";
+
+	out << 
+	"    }\n"
+	"}\n"
+	"\n\n";
+}
+
+
+bool Schematic::HasConstantParameters(const std::shared_ptr<BlockData>& block_lib){
+	for(const auto& p: block_lib->Parameters())
+		if(IsConstantParameterType(p.type)) return true;
+	return false;
+}
+
+
+void Schematic::WriteBlockType(CodeWriter& out, const Block& block, const std::unordered_map<const BlockData*, std::string>& class_names){
+	auto lib_block = block.lib_block.lock();
+	auto class_name = lib_block ? class_names.find(lib_block.get()) : class_names.end();
+
+	if(class_name != class_names.end())
+		out << class_name->second;
+	else
+		out << CodeClassName(block.full_name) << "_block";
+
+	if(lib_block && code_options.constant_parameters && HasConstantParameters(lib_block))
+		out << "<block_" << block.id << "_params>";
+}
+
 
-	// step 4 - temporary assing nullptr to all inputs
-	std::list<std::string> block_inputs;
+// value of parameter as c++ literal followed by ';'
+void Schematic::WriteParameterValue(CodeWriter& out, const std::string& type, const Block& block, int i){
+	const auto& params = block.parameters;
+	const bool has_value = i < params.size();
+
+	// check for bool value 
+	if(type == "bool"){
+		if(has_value && std::holds_alternative<bool>(params[i]))
+			out << (std::get<bool>(params[i]) ? "true;" : "false;");
+		else
+			out << (has_value ? "false; // variant error" : "false; // default");
+	}
+
+	// check for double value 
+	else if(type == "double"){
+		if(has_value && std::holds_alternative<double>(params[i]))
+			out.Double(std::get<double>(params[i])) << ';';
+		else
+			out << (has_value ? "0.0; // variant error" : "0.0; // default");
+	}
+
+	// check for int64_t value 
+	else if(type == "int64_t"){
+		if(has_value && std::holds_alternative<int64_t>(params[i]))
+			out << std::get<int64_t>(params[i]) << ';';
+		else
+			out << (has_value ? "0; // variant error" : "0; // default");
+	}
+
+	// check for std::string value 
+	else if(type == "std::string"){
+		if(has_value && std::holds_alternative<std::string>(params[i]))
+			out << '"' << std::get<std::string>(params[i]) << "\";";
+		else
+			out << (has_value ? "\"\"; // variant error" : "\"\"; // default");
+	}
+}
+
+
+void Schematic::BuildBlockInstances(CodeWriter& out, const std::unordered_map<const BlockData*, std::string>& class_names){
+
+	out << 
+	"\n\n"
+	"int main(){\n"
+	"\n\n"
+	"// 	block instances\n"
+	"\n\n";
+
+	// step 1 - create all objects representing blocks
 	for(const auto& block: blocks){
+		if(!code_plan.IsEmitted(block->id)) continue;
+
 		auto lib_block = block->lib_block.lock();
-		if(!lib_block) continue;
-		const int count = lib_block->Inputs().size();
 
-		std::string block_name = "block_" + std::to_string(block->id);
+		out << "    ";
+		WriteBlockType(out, *block, class_names);
+		out << " block_" << block->id << ";\n";
+	}
 
-		for(int i = 0; i < count; i++){
-			std::string input_name = "input" + std::to_string(i);
-			std::string assign_null = block_name + "." + input_name + " = nullptr;";
-			block_inputs.push_back(assign_null);
-		}
+	WriteLogicDeclarations(out);
+
+	out << 
+	"\n\n";
+
+	// step 2 - temporary assing nullptr to all inputs
+	for(const auto& block: blocks){
+		auto lib_block = block->lib_block.lock();
+		if(!lib_block || !code_plan.IsEmitted(block->id)) continue;
+		const int count = lib_block->Inputs().size();
+
+		for(int i = 0; i < count; i++)
+			out << "    block_" << block->id << ".input" << i << " = nullptr;\n";
 	}
 
-	std::list<std::string> connections_cpp;
-	// step 5 - create connections between blocks;
+	out << 
+	"\n\n"
+	"// 	connections\n"
+	"\n\n";
+
+	// step 3 - create connections between blocks;
 	for(const auto& conn: connetions){
 		auto src = conn.src.lock();
 		auto dst = conn.dst.lock();
 
 		if(!dst || !src) continue; // TODO: handle this error later;
+		if(!code_plan.IsEmitted(dst->id)) continue;
 
-		std::string src_name = "block_" + std::to_string(src->id);
-		std::string dst_name = "block_" + std::to_string(dst->id);
-		std::string src_output_name = "output" + std::to_string(conn.src_pin);
-		std::string dst_input_name = "input" + std::to_string(conn.dst_pin);
+		out << "    block_" << dst->id << ".input" << conn.dst_pin << " = &";
+		WriteSignal(out, src->id, conn.src_pin);
+		out << ";\n";
+	}
+}
 
-		std::string conn_code = dst_name + "." + dst_input_name + " = &" + src_name + "." + src_output_name + ";";
 
-		connections_cpp.push_back(conn_code);
-	}
+void Schematic::BuildSignalTable(CodeWriter& out, const std::unordered_map<const BlockData*, std::string>& class_names){
+
+	// step 1 - one slot per block output, in execution order
+	out << 
+	"\n\n"
+	"// 	signal table\n"
+	"\n\n"
+	"struct alignas(64) PLC_SignalTable {\n";
+
+	// blocks of boolean networks keep only slots read outside of network
+	std::unordered_set<int64_t> network_outputs;
+	for(const auto& network: code_plan.networks)
+		network_outputs.insert(network.outputs.begin(), network.outputs.end());
 
-	std::list<std::string> parameters_cpp;
-	// step 6 - setup parameters
 	for(const auto& block: blocks){
+		auto lib_block = block->lib_block.lock();
+		if(!lib_block || code_plan.IsRemoved(block->id)) continue;
+
+		const bool packed = !code_plan.IsEmitted(block->id);
+		const auto& outputs = lib_block->Outputs();
+		for(int i = 0; i < outputs.size(); i++)
+			if(!packed || network_outputs.count(CodePlan::PinKey(block->id, i)))
+				out << "    " << outputs[i].type << " b" << block->id << "_o" << i << "{};\n";
+	}
 
+	out << 
+	"};\n"
+	"\n"
+	"static PLC_SignalTable signals;\n"
+	"\n";
 
+	// step 2 - shared constant slot for unconnected inputs of every type
+	std::unordered_map<std::string, std::string> default_slots;
+	for(const auto& block: blocks){
 		auto lib_block = block->lib_block.lock();
-		if(!lib_block) continue;
+		if(!lib_block || !code_plan.IsEmitted(block->id)) continue;
 
-		auto params = block->parameters;
-		auto lib_params =lib_block->Parameters();
+		const auto& inputs = lib_block->Inputs();
+		for(int i = 0; i < inputs.size(); i++){
+			if(FindInputConnection(block->id, i) || default_slots.count(inputs[i].type)) continue;
 
+			std::string name = "signal_default_" + std::to_string(default_slots.size());
+			out << "static const " << inputs[i].type << " " << name << "{};\n";
+			default_slots.emplace(inputs[i].type, std::move(name));
+		}
+	}
 
-		std::string object_name = "block_" + std::to_string(block->id);
-		
-		for(int i = 0; i < lib_params.size(); i++){
+	out << 
+	"\n\n"
+	"int main(){\n"
+	"\n\n"
+	"// 	block instances\n"
+	"\n\n";
 
-			std::string param_str;
-
-			// check for bool value 
-			if(lib_params[i].type == "bool"){
-				if(i < params.size()){
-					if(std::holds_alternative<bool>(params[i])){
-						std::string val = std::get<bool>(params[i]) ? "true" : "false";
-						param_str = object_name + ".parameter" + std::to_string(i) + " = " + val + ";";
-					}else{
-						param_str = object_name + ".parameter" + std::to_string(i) + " = false; // variant error";
-					}
-				}else{
-					param_str = object_name + ".parameter" + std::to_string(i) + " = false; // default";
-				}
+	// step 3 - create objects bound to their table slots
+	for(const auto& block: blocks){
+		if(!code_plan.IsEmitted(block->id)) continue;
+
+		auto lib_block = block->lib_block.lock();
+
+		out << "    ";
+		WriteBlockType(out, *block, class_names);
+		out << " block_" << block->id;
+
+		if(lib_block && (!lib_block->Inputs().empty() || !lib_block->Outputs().empty())){
+			const auto& inputs = lib_block->Inputs();
+			const int output_count = lib_block->Outputs().size();
+			const char* separator = "(";
+
+			for(int i = 0; i < inputs.size(); i++){
+				out << separator;
+				separator = ", ";
+
+				const Connection* conn = FindInputConnection(block->id, i);
+				auto src = conn ? conn->src.lock() : nullptr;
+				const bool* value = src ? code_plan.Constant(src->id, conn->src_pin) : nullptr;
+				if(value)
+					out << (*value ? "plc_const_true" : "plc_const_false");
+				else if(src)
+					out << "signals.b" << src->id << "_o" << conn->src_pin;
+				else
+					out << default_slots[inputs[i].type];
 			}
 
-			// check for double value 
-			else if(lib_params[i].type == "double"){
-				if(i < params.size()){
-					if(std::holds_alternative<double>(params[i])){
-						std::stringstream ss;
-						ss << std::setprecision(18) << std::get<double>(params[i]);
-						std::string val = ss.str();
-
-						param_str =  object_name + ".parameter" + std::to_string(i) + " = " + val + ";";
-					}else{
-						param_str =  object_name + ".parameter" + std::to_string(i) + " = 0.0; // variant error";
-					}
-				}else{
-					param_str =  object_name + ".parameter" + std::to_string(i) + " = 0.0; // default";
-				}
+			for(int i = 0; i < output_count; i++){
+				out << separator << "signals.b" << block->id << "_o" << i;
+				separator = ", ";
 			}
 
-			// check for int64_t value 
-			else if(lib_params[i].type == "int64_t"){
-				if(i < params.size()){
-					if(std::holds_alternative<int64_t>(params[i])){
-						std::string val = std::to_string(std::get<int64_t>(params[i]));
-						param_str = object_name + ".parameter" + std::to_string(i) + " = " + val + ";";
-					}else{
-						param_str = object_name + ".parameter" + std::to_string(i) + " = 0; // variant error";
-					}
-				}else{
-					param_str = object_name + ".parameter" + std::to_string(i) + " = 0; // default";
-				}
+			out << ')';
+		}
+		out << ";\n";
+	}
+
+	WriteLogicDeclarations(out);
+}
+
+
+const Schematic::BlockClassCode* Schematic::GetBlockClass(const std::shared_ptr<BlockData>& block_lib){
+
+	std::string full_name = block_lib->FullName();
+
+	// step 1 - collect cache key
+	std::error_code ec;
+	const std::filesystem::path code_path = block_lib->CodePath();
+	auto code_time = std::filesystem::last_write_time(code_path, ec);
+	if(ec) { class_cache.erase(full_name); return nullptr; }
+	auto code_size = std::filesystem::file_size(code_path, ec);
+	if(ec) { class_cache.erase(full_name); return nullptr; }
+
+	std::string io_signature;
+	for(const auto* io_list: {&block_lib->Inputs(), &block_lib->Parameters(), &block_lib->Outputs()}){
+		for(const auto& io: *io_list)
+			io_signature += io.type + ";";
+		io_signature += "|";
+	}
+	if(code_options.signal_table) io_signature += "signal_table|";
+	if(code_options.constant_parameters) io_signature += "constant_parameters|";
+
+	// step 2 - reuse class if nothing changed
+	auto it = class_cache.find(full_name);
+	if(it != class_cache.end()){
+		const ClassCacheEntry& entry = it->second;
+		if(entry.code_time == code_time && entry.code_size == code_size && entry.io_signature == io_signature)
+			return &entry.code;
+	}
+
+	// step 3 - generate class and store it
+	ClassCacheEntry entry;
+	if(!BuildBlockClass(block_lib, &entry.code)){
+		class_cache.erase(full_name);
+		return nullptr; //TODO: handle this error later;
+	}
+	entry.code_time = code_time;
+	entry.code_size = code_size;
+	entry.io_signature = std::move(io_signature);
+
+	auto& stored = class_cache[full_name];
+	stored = std::move(entry);
+	return &stored.code;
+}
+
+
+bool Schematic::BuildBlockClass(const std::shared_ptr<BlockData>& block_lib, BlockClassCode* result){
+
+	std::string code;
+
+	{// 1 - read code from file
+		BlockData::Error err = block_lib->ReadCode(&code);
+		if(err != BlockData::Error::OK) return false;
+
+		// convert '\r' -> '\n' to prevent errors
+		std::replace(code.begin(), code.end(), '\r', '\n');
+	}
+
+	{// 2 - process code and replace name with full_name;
+
+		std::string user_include;
+		std::string user_functions;
+		std::string user_init_func_body;
+		std::string user_update_func_body;
+
+		// extract code
+		CodeExtractSection(code, &user_include, "includes");
+		CodeExtractSection(code, &user_functions, "functions");
+		CodeExtractSection(code, &user_init_func_body, "init");
+		CodeExtractSection(code, &user_update_func_body, "update");
+
+		result->name = CodeClassName(block_lib->FullName()) + "_block";
+		result->has_init = user_init_func_body.find_first_not_of(" \t\n") != std::string::npos;
+
+		// class members
+		CodeWriter members;
+		const auto& inputs = block_lib->Inputs();
+		const auto& parameters = block_lib->Parameters();
+		const auto& outputs = block_lib->Outputs();
+
+		// constant parameters - values come from template argument 'P' of the class
+		result->is_template = code_options.constant_parameters && HasConstantParameters(block_lib);
+		auto WriteParameters = [&](){
+			for(int i = 0; i < parameters.size(); i++){
+				if(result->is_template && IsConstantParameterType(parameters[i].type))
+					members << "    static constexpr " << parameters[i].type << " parameter" << i << " = P::parameter" << i << ";\n";
+				else
+					members << "    " << parameters[i].type << "  parameter" << i << ";\n";
+			}
+		};
+
+		if(!code_options.signal_table){
+			for(int i = 0; i < inputs.size(); i++)
+				members << "    const " << inputs[i].type << "* input" << i << ";\n";
+
+			WriteParameters();
+
+			for(int i = 0; i < outputs.size(); i++)
+				members << "    " << outputs[i].type << "  output" << i << ";\n";
+		}else{
+			// signal table - inputs are bound to table or default slot (never null), outputs are table slots
+			for(int i = 0; i < inputs.size(); i++)
+				members << "    const PLC_Input<" << inputs[i].type << "> input" << i << ";\n";
+
+			WriteParameters();
+
+			for(int i = 0; i < outputs.size(); i++)
+				members << "    " << outputs[i].type << "& output" << i << ";\n";
+
+			if(!inputs.empty() || !outputs.empty()){
+				members << "\n    " << result->name << "(";
+				for(int i = 0; i < inputs.size(); i++)
+					members << (i ? ", " : "") << "const " << inputs[i].type << "& _input" << i;
+				for(int i = 0; i < outputs.size(); i++)
+					members << (i || !inputs.empty() ? ", " : "") << outputs[i].type << "& _output" << i;
+				members << ")";
+
+				for(int i = 0; i < inputs.size(); i++)
+					members << (i ? ", " : "\n        : ") << "input" << i << "{_input" << i << "}";
+				for(int i = 0; i < outputs.size(); i++)
+					members << (i || !inputs.empty() ? ", " : "\n        : ") << "output" << i << "(_output" << i << ")";
+				members << " {}\n";
 			}
+		}
 
-			// check for std::string value 
-			else if(lib_params[i].type == "std::string"){
-				if(i < params.size()){
-					if(std::holds_alternative<std::string>(params[i])){
-						std::string val = std::get<std::string>(params[i]);
-						param_str = object_name + ".parameter" + std::to_string(i) + " = \"" + val + "\";";
-					}else{
-						param_str = object_name + ".parameter" + std::to_string(i) + " = \"\"; // variant error";
-					}
-				}else{
-					param_str = object_name + ".parameter" + std::to_string(i) + " = \"\"; // default";
-				}
+		const std::string class_members = members.Release();
+		const char* class_prefix = result->is_template ? "\n\ntemplate<class P>\nclass " : "\n\nclass ";
+
+		{// 2.1 - single file class
+			CodeWriter out(code.size() + 1024);
+
+			// class prolog
+			out << user_include 
+				<< class_prefix << result->name << "{ \n"
+				<< "public: \n"
+				<< class_members
+				<< user_functions;
+
+			// init function 
+			out <<	"\n" 
+					"    void init(){\n"
+				<< user_init_func_body;
+
+			// update function
+			out <<	"\n"
+					"    }\n"
+					"\n"        
+					"    void update(){\n"
+				<< user_update_func_body;
+			
+			// class epilogue
+			out <<	"\n"
+					"    }\n"
+					"};\n";
+
+			result->code = out.Release();
+		}
+
+		{// 2.2 - class header for split output
+			CodeWriter out(user_include.size() + class_members.size() + user_functions.size() + 1024);
+
+			out <<	"#pragma once\n"
+					"#include <string>\n"
+					"#include <inttypes.h>\n"
+					"#include <PLC_app.hpp>\n"
+					"#include \"process_image.hpp\"\n";
+
+			// template class is defined whole in header, there is no source file
+			if(result->is_template){
+				out << result->code;
+			}else{
+				out << user_include 
+					<< "\n\nclass " << result->name << "{ \n"
+					<< "public: \n"
+					<< class_members
+					<< user_functions
+					<< "\n"
+					   "    void init();\n"
+					   "    void update();\n"
+					   "};\n";
 			}
 
-			parameters_cpp.push_back(param_str);
+			result->header = out.Release();
 		}
 
+		if(!result->is_template){// 2.3 - init/update definitions for split output
+			CodeWriter out(user_init_func_body.size() + user_update_func_body.size() + 1024);
 
-	}
+			out << "#include \"" << result->name << ".hpp\"\n"
+				<< "\n"
+				<< "void " << result->name << "::init(){\n"
+				<< user_init_func_body
+				<< "\n}\n"
+				<< "\n"
+				<< "void " << result->name << "::update(){\n"
+				<< user_update_func_body
+				<< "\n}\n";
 
+			result->source = out.Release();
+		}
+	}
 
-	// step 7 - merge all code
+	return true;
+}
 
-	std::string code = 
-	"#include <string>\n"
-	"#include <inttypes.h>\n"
-	"#include <PLC_app.hpp>"
-	"\n\n"
-	"// 	block classes"
-	"\n\n";
 
-	for(std::string& _class: blocks_cpp_classes)
-		code += _class + "\n"; 
-	
+std::string Schematic::CodeClassName(const std::string& full_name){
+	// replace '/' and '\' with '__'
+	std::string name;
+	name.reserve(full_name.size() + 8);
+	for(char c: full_name){
+		if(c == '\\' || c == '/') name += "__";
+		else name += c;
+	}
+	return name;
+}
 
-	code += 
-	"\n\n"
-	"int main(){\n"
-	"\n\n"
-	"// 	block instances\n"
-	"\n\n";
 
-	for(std::string& object: blocks_cpp_objects)
-		code += "    " + object + "\n";
+void Schematic::IndexConnection(std::list<Connection>::iterator iter){
+	Connection* conn = &(*iter);
 
-	code += 
-	"\n\n";
+	connection_index[conn->id] = iter;
 
-	for(std::string& inputs: block_inputs)
-		code += "    " + inputs + "\n";
+	// if pin is already connected, new connection replaces old one in index
+	if(auto dst = conn->dst.lock()){
+		if(conn->dst_pin >= 0){
+			auto& inputs = links_index[dst->id].inputs;
+			if(inputs.size() <= conn->dst_pin) inputs.resize(conn->dst_pin + 1, nullptr);
+			inputs[conn->dst_pin] = conn;
+		}
+	}
 
-	code += 
-	"\n\n"
-	"// 	connections\n"
-	"\n\n";
+	if(auto src = conn->src.lock()){
+		links_index[src->id].outputs.push_back(conn);
+	}
+}
 
-	for(std::string& conn: connections_cpp)
-		code += "    " + conn + "\n";
 
-	code += 
-	"\n\n"
-	"// 	parameters\n"
-	"\n\n";
+void Schematic::UnindexConnection(Connection* conn){
 
-	for(std::string& params: parameters_cpp)
-		code += "    " + params + "\n";
+	auto conn_iter = connection_index.find(conn->id);
+	if(conn_iter != connection_index.end() && &(*conn_iter->second) == conn)
+		connection_index.erase(conn_iter);
 
-	code += 
-	"\n\n"
-	"// 	Init blocks\n"
-	"\n\n";
+	if(auto dst = conn->dst.lock()){
+		auto links_iter = links_index.find(dst->id);
+		if(links_iter != links_index.end()){
+			auto& inputs = links_iter->second.inputs;
+			if(conn->dst_pin >= 0 && conn->dst_pin < inputs.size() && inputs[conn->dst_pin] == conn)
+				inputs[conn->dst_pin] = nullptr;
+		}
+	}
 
-	for(std::string& inits: blocks_cpp_init)
-		code += "    " + inits + "\n";
+	if(auto src = conn->src.lock()){
+		auto links_iter = links_index.find(src->id);
+		if(links_iter != links_index.end()){
+			auto& outputs = links_iter->second.outputs;
+			auto out_iter = std::find(outputs.begin(), outputs.end(), conn);
+			if(out_iter != outputs.end()) outputs.erase(out_iter);
+		}
+	}
+}
 
-	code += 
-	"\n\n"
-	"    while(true){\n\n"
-	"       if(!PLC::LoopStart()) return 0;\n"
-	"// 	Update blocks\n"
-	"\n\n";
 
-	for(std::string& inits: blocks_cpp_update)
-		code += "        " + inits + "\n";
+void Schematic::RebuildIndex(){
 
+	block_index.clear();
+	connection_index.clear();
+	links_index.clear();
 
-	code += 
-	"\n"
-	"       PLC::LoopEnd();"
-	"\n"
-	"    }\n"
-	"}\n"
-	"\n\n";
+	block_index.reserve(blocks.size());
+	connection_index.reserve(connetions.size());
+	links_index.reserve(blocks.size());
 
+	for(auto& block: blocks){
+		if(!block) continue;
+		block_index[block->id] = block;
+	}
 
-	return code;
+	for(auto iter = connetions.begin(); iter != connetions.end(); iter++){
+		IndexConnection(iter);
+	}
 
+	RebuildOrderIndex();
 }
 
 
 std::vector<Schematic::Connection> Schematic::GetAllBlockInputConnections(std::shared_ptr<Schematic::Block> block){
 
 	std::vector<Schematic::Connection> conns;
-	for(Connection conn: connetions){
-		std::shared_ptr<Schematic::Block> dst_block = conn.dst.lock();
+	if(!block) return conns;
+
+	auto iter = links_index.find(block->id);
+	if(iter == links_index.end()) return conns;
 
-		if(!conn.IsValid()) continue;
+	for(Connection* conn: iter->second.inputs){
+		if(!conn) continue;
+		if(!conn->IsValid()) continue;
+		if(conn->dst.lock() != block) continue;
 
-		if(dst_block)
-			if(dst_block == block)
-				conns.push_back(conn);
+		conns.push_back(*conn);
 	}
 
 	return conns;
@@ -761,131 +1854,444 @@ std::vector<Schematic::Connection> Schematic::GetAllBlockInputConnections(std::s
 
 
 
-void Schematic::SortBlocks(){
+Schematic::ExecutionGraph Schematic::BuildExecutionGraph(){
 
+	ExecutionGraph graph;
+	std::unordered_map<int, int> node_of_block; // block id -> node index
 
-	struct BlockConnGroup{
-		std::shared_ptr<Block> block;
-		std::vector<Schematic::Connection> connections;
-		BlockConnGroup(std::shared_ptr<Block> b, std::vector<Schematic::Connection> conns): block(b), connections(conns){
-			block->is_sorted = false; // clear sort flags
-		}
+	graph.nodes.reserve(blocks.size());
+	node_of_block.reserve(blocks.size());
 
-		bool IsAllConnectedToSorted(){
-			for(int i = 0; i < connections.size(); i++){
-				auto src_block = connections[i].src.lock(); 
-				if(!src_block->is_sorted) return false;
-			}
-			return true;
+	// nodes - every valid block in current order
+	for(auto& block: blocks){
+		if(!block) continue;
+		if(!block->lib_block.lock()) continue;
+		node_of_block[block->id] = graph.nodes.size();
+		graph.nodes.push_back(block);
+	}
+
+	const int count = graph.nodes.size();
+	graph.successors.resize(count);
+	graph.input_count.resize(count, 0);
+
+	// edges - one for every valid connection
+	for(int i = 0; i < count; i++){
+		for(auto& conn: GetAllBlockInputConnections(graph.nodes[i])){
+			auto src = conn.src.lock();
+			if(!src) continue;
+
+			auto iter = node_of_block.find(src->id);
+			if(iter == node_of_block.end()) continue;
+
+			graph.successors[iter->second].push_back(i);
+			graph.input_count[i]++;
 		}
+	}
+
+	return graph;
+}
 
-		bool IsAnyConnectedToSorted(){
-			for(int i = 0; i < connections.size(); i++){
-				auto src_block = connections[i].src.lock(); 
-				if(src_block->is_sorted) return true;
+
+
+// Blocks are ordered with Kahn algorithm. 
+// From all blocks ready to be placed, block that is first in current order is always picked, 
+// so blocks are ordered exactly as by the original (quadratic) algorithm:
+//   1) blocks without any input pins
+//   2) blocks without any input connections
+//   3) block connected with every input to already sorted blocks
+//   4) (feedback loop) block connected with at least one input to already sorted block
+//   5) (feedback loop) first not sorted block
+//
+// Picking first ready block needs priority queue, so complexity is O(E + V*log(V)).
+// Blocks of every feedback loop are grouped together afterwards (GroupFeedbackLoops).
+void Schematic::SortBlocks(){
+
+	ExecutionGraph graph = BuildExecutionGraph();
+	const int count = graph.nodes.size();
+
+	typedef std::priority_queue<int, std::vector<int>, std::greater<int>> MinQueue;
+
+	MinQueue all_inputs_sorted;  // step 3 candidates
+	MinQueue any_input_sorted;   // step 4 candidates
+	int first_not_sorted = 0;    // step 5 candidate
+
+	std::vector<int> not_sorted_inputs = graph.input_count;
+	std::vector<int> order;
+	order.reserve(count);
+
+	for(auto& block: graph.nodes) block->is_sorted = false; // clear sort flags
+
+	auto Place = 
+		[&](int node)
+		{
+			graph.nodes[node]->is_sorted = true;
+			order.push_back(node);
+
+			for(int next: graph.successors[node]){
+				if(graph.nodes[next]->is_sorted) continue;
+
+				not_sorted_inputs[next]--;
+				if(not_sorted_inputs[next] == 0) all_inputs_sorted.push(next);
+				else any_input_sorted.push(next);
+			}
+		};
+
+	auto PlaceFromQueue = 
+		[&](MinQueue& queue) -> bool
+		{
+			while(!queue.empty()){
+				int node = queue.top();
+				queue.pop();
+				if(graph.nodes[node]->is_sorted) continue; // already placed
+				Place(node);
+				return true;
 			}
 			return false;
-		}
-	};
+		};
 
-	std::list<BlockConnGroup> not_sorted;
-	std::list<std::shared_ptr<Block>> sorted;
 
-	for(auto block: blocks){
-		// check if block is valid 
-		if(!block) continue;
-		if(!block->lib_block.lock()) continue;
-		not_sorted.emplace_back(block, GetAllBlockInputConnections(block));
+	// step 1 - blocks without any input pins
+	for(int i = 0; i < count; i++){
+		auto lib_block = graph.nodes[i]->lib_block.lock();
+		if(lib_block->Inputs().empty()) Place(i);
 	}
 
-	typedef std::list<BlockConnGroup>::iterator UnsortedIter;
+	// step 2 - blocks without any input connections
+	for(int i = 0; i < count; i++){
+		if(graph.nodes[i]->is_sorted) continue;
+		if(graph.input_count[i] == 0) Place(i);
+	}
 
+	// step 3 - iterate over every step until all blocks is sorted
+	while(order.size() < count){
 
-	// step 1 - find blocks without any input pins
-	bool found_all = false;
-	while(!found_all){ 
-		UnsortedIter iter;
-		for(iter = not_sorted.begin(); iter != not_sorted.end(); iter++){
-			auto lib_block = iter->block->lib_block.lock();
-			if(lib_block->Inputs().empty()) break;
-		}
+		// step 3.1 - find block connected with every pin to already sorted block
+		if(PlaceFromQueue(all_inputs_sorted)) continue;
 
-		if(iter != not_sorted.end()){
-			sorted.push_back(iter->block);
-			sorted.back()->is_sorted = true;
-			not_sorted.erase(iter);
-			continue;
-		}
+		// step 3.2 - find block connected to at least one sorted block
+		// this happens only if schematic contains feedback loop
+		if(PlaceFromQueue(any_input_sorted)) continue;
 
-		found_all = true;
+		// step 3.3 - if none of blocks matches any criteria, just pick first in list 
+		while(graph.nodes[first_not_sorted]->is_sorted) first_not_sorted++;
+		Place(first_not_sorted);
 	}
 
-	 // step 2 - find block without any input connections
-	found_all = false;
-	while(!found_all){
-		UnsortedIter iter;
-		for(iter = not_sorted.begin(); iter != not_sorted.end(); iter++){
-			if(iter->connections.empty()) break;
+	// final step - store result in main containter
+	std::list<std::shared_ptr<Block>> sorted;
+	for(int node: order) sorted.push_back(graph.nodes[node]);
+	blocks.swap(sorted);
+
+	// blocks without library block are removed from list, so index must be updated 
+	RebuildIndex();
+	FindFeedbackLoops();
+	if(!feedback_loops.empty()) GroupFeedbackLoops();
+
+	order_dirty = false;
+}
+
+
+
+// Every feedback loop is moved to one place, blocks of loop keep their relative order.
+// Loops and blocks outside of them are ordered topologically (first in current order is picked
+// from ready ones), so only blocks inside loop read values from previous cycle, every other
+// block runs after all its sources. Incremental order then handles each loop as a single block.
+void Schematic::GroupFeedbackLoops(){
+
+	ExecutionGraph graph = BuildExecutionGraph();
+	const int count = graph.nodes.size();
+
+	// step 1 - component of every block, blocks of loop share one, numbered by first block
+	std::vector<int> component(count);
+	std::vector<std::vector<int>> members;
+	std::unordered_map<int, int> loop_component;
+
+	for(int i = 0; i < count; i++){
+		auto loop = feedback_loop_blocks.find(graph.nodes[i]->id);
+		if(loop != feedback_loop_blocks.end()){
+			auto [iter, added] = loop_component.try_emplace(loop->second, (int)members.size());
+			if(added) members.emplace_back();
+			component[i] = iter->second;
+		}else{
+			component[i] = members.size();
+			members.emplace_back();
 		}
+		members[component[i]].push_back(i);
+	}
 
-		if(iter != not_sorted.end()){
-			sorted.push_back(iter->block);
-			sorted.back()->is_sorted = true;
-			not_sorted.erase(iter);
-			continue;
+	// step 2 - connections between components
+	std::vector<int> not_sorted_inputs(members.size(), 0);
+	for(int i = 0; i < count; i++)
+		for(int next: graph.successors[i])
+			if(component[next] != component[i]) not_sorted_inputs[component[next]]++;
+
+	// step 3 - Kahn algorithm over components (there are no loops between them)
+	std::priority_queue<int, std::vector<int>, std::greater<int>> ready;
+	for(int c = 0; c < members.size(); c++)
+		if(not_sorted_inputs[c] == 0) ready.push(c);
+
+	std::list<std::shared_ptr<Block>> grouped;
+	while(!ready.empty()){
+		int c = ready.top();
+		ready.pop();
+
+		for(int node: members[c]){
+			grouped.push_back(graph.nodes[node]);
+			for(int next: graph.successors[node])
+				if(component[next] != c && --not_sorted_inputs[component[next]] == 0) ready.push(component[next]);
 		}
+	}
+
+	blocks.swap(grouped);
+	RebuildOrderIndex();
+}
+
+
+
+void Schematic::RebuildOrderIndex(){
+	order_index.clear();
+	if(!incremental_order) return; // 'blocks' may be reordered directly, index would not follow it
+	order_index.reserve(blocks.size());
 
-		found_all = true;
+	next_ord = 0;
+	for(auto iter = blocks.begin(); iter != blocks.end(); iter++){
+		if(!(*iter)) continue;
+		order_index[(*iter)->id] = OrderEntry{next_ord++, iter};
 	}
+}
 
 
-	// step 3 - iterate over every step until all blocks is sorted
-	while(!not_sorted.empty()){
 
-		
-		{ // step 3.1 - find block connected with every pin to already sorted block
-			UnsortedIter iter;
-			for(iter = not_sorted.begin(); iter != not_sorted.end(); iter++){
-				if(iter->IsAllConnectedToSorted()) break;
+void Schematic::OrderAddBlock(std::list<std::shared_ptr<Block>>::iterator position){
+	// new block has no connections, so it can be executed last
+	if(incremental_order) order_index[(*position)->id] = OrderEntry{next_ord++, position};
+}
+
+
+
+// Pearce-Kelly algorithm
+// D. J. Pearce, P. H. J. Kelly - "A Dynamic Topological Sort Algorithm for Directed Acyclic Graphs"
+void Schematic::OrderAddConnection(const Connection* conn){
+	if(!incremental_order || order_dirty) return;
+
+	auto src = conn->src.lock();
+	auto dst = conn->dst.lock();
+	if(!src || !dst) return;
+
+	auto src_iter = order_index.find(src->id);
+	auto dst_iter = order_index.find(dst->id);
+
+	if(src_iter == order_index.end() || dst_iter == order_index.end()){
+		order_dirty = true;
+		return;
+	}
+
+	// connection to or from feedback loop may change the loop
+	if(feedback_loop_blocks.count(src->id) || feedback_loop_blocks.count(dst->id)){
+		order_dirty = true;
+		return;
+	}
+
+	const int upper_bound = src_iter->second.ord;
+	const int lower_bound = dst_iter->second.ord;
+
+	// order is still valid
+	if(lower_bound > upper_bound) return;
+
+	// block connected to itself
+	if(src == dst){
+		order_dirty = true;
+		return;
+	}
+
+	std::unordered_set<int> visited;
+	std::vector<int> stack;
+
+	// step 1 - blocks reachable from destination (with ord lower than source)
+	std::vector<int> forward;
+	stack.push_back(dst->id);
+	visited.insert(dst->id);
+
+	while(!stack.empty()){
+		int id = stack.back();
+		stack.pop_back();
+		forward.push_back(id);
+
+		for(Connection* out: FindOutputConnections(id)){
+			auto next = out->dst.lock();
+			if(!next) continue;
+
+			// connection creates feedback loop - order must be calculated from scratch
+			if(next->id == src->id){
+				order_dirty = true;
+				return;
 			}
 
-			if(iter != not_sorted.end()){
-				sorted.push_back(iter->block);
-				sorted.back()->is_sorted = true;
-				not_sorted.erase(iter);
-				continue;
+			auto next_iter = order_index.find(next->id);
+			if(next_iter == order_index.end()) continue;
+			if(next_iter->second.ord >= upper_bound) continue;
+			if(!visited.insert(next->id).second) continue;
+
+			// loop would have to be moved as a whole
+			if(feedback_loop_blocks.count(next->id)){
+				order_dirty = true;
+				return;
 			}
+
+			stack.push_back(next->id);
 		}
+	}
 
-		{ // step 3.2 - find block connected to at least one sorted block
-			UnsortedIter iter;
-			for(iter = not_sorted.begin(); iter != not_sorted.end(); iter++){
-				if(iter->IsAnyConnectedToSorted()) break;
-			}
+	// step 2 - blocks from which source is reachable (with ord higher than destination)
+	std::vector<int> backward;
+	stack.push_back(src->id);
+	visited.insert(src->id);
 
-			if(iter != not_sorted.end()){
-				sorted.push_back(iter->block);
-				sorted.back()->is_sorted = true;
-				not_sorted.erase(iter);
-				continue;
+	while(!stack.empty()){
+		int id = stack.back();
+		stack.pop_back();
+		backward.push_back(id);
+
+		auto links_iter = links_index.find(id);
+		if(links_iter == links_index.end()) continue;
+
+		for(Connection* in: links_iter->second.inputs){
+			if(!in) continue;
+			auto prev = in->src.lock();
+			if(!prev) continue;
+
+			auto prev_iter = order_index.find(prev->id);
+			if(prev_iter == order_index.end()) continue;
+			if(prev_iter->second.ord <= lower_bound) continue;
+			if(!visited.insert(prev->id).second) continue;
+
+			if(feedback_loop_blocks.count(prev->id)){
+				order_dirty = true;
+				return;
 			}
-		}
 
-		// step 3.3 - if none of blocks matches any criteria, just pick first in list 
-		// this situation should never happen
-		{ 
-			UnsortedIter iter = not_sorted.begin();
-			sorted.push_back(iter->block);
-			sorted.back()->is_sorted = true;
-			not_sorted.erase(iter);
-			continue;
+			stack.push_back(prev->id);
 		}
-
 	}
 
-	// final step - store result in main containter
-	blocks.swap(sorted);
+	// step 3 - reorder affected blocks: 'backward' blocks go before 'forward' blocks, 
+	// both groups keep their relative order. blocks reuse ords and list positions of affected region
+	auto ByOrd = 
+		[this](int a, int b){ return order_index[a].ord < order_index[b].ord; };
+
+	std::sort(forward.begin(), forward.end(), ByOrd);
+	std::sort(backward.begin(), backward.end(), ByOrd);
+
+	std::vector<int> affected;
+	affected.reserve(forward.size() + backward.size());
+	affected.insert(affected.end(), backward.begin(), backward.end());
+	affected.insert(affected.end(), forward.begin(), forward.end());
+
+	std::vector<OrderEntry> slots;
+	slots.reserve(affected.size());
+	for(int id: affected) slots.push_back(order_index[id]);
+
+	std::sort(slots.begin(), slots.end(), 
+		[](const OrderEntry& a, const OrderEntry& b){ return a.ord < b.ord; });
 
+	std::vector<std::shared_ptr<Block>> affected_blocks;
+	affected_blocks.reserve(affected.size());
+	for(int id: affected) affected_blocks.push_back(*(order_index[id].position));
 
+	for(int i = 0; i < affected.size(); i++){
+		*(slots[i].position) = affected_blocks[i];
+		order_index[affected[i]] = slots[i];
+	}
 }
 
+
+
+// Tarjan's strongly connected components algorithm (iterative version)
+// every component with more than one block (or block connected to itself) is feedback loop 
+void Schematic::FindFeedbackLoops(){
+
+	feedback_loops.clear();
+	feedback_loop_blocks.clear();
+
+	ExecutionGraph graph = BuildExecutionGraph();
+	const int count = graph.nodes.size();
+
+	struct Frame{
+		int node;
+		size_t next_successor;
+	};
+
+	std::vector<int> index(count, -1);
+	std::vector<int> low_link(count, 0);
+	std::vector<bool> on_stack(count, false);
+	std::vector<int> stack;
+	std::vector<Frame> call_stack;
+	int next_index = 0;
+
+	auto Visit = 
+		[&](int node)
+		{
+			index[node] = next_index;
+			low_link[node] = next_index;
+			next_index++;
+			stack.push_back(node);
+			on_stack[node] = true;
+			call_stack.push_back({node, 0});
+		};
+
+	for(int root = 0; root < count; root++){
+		if(index[root] != -1) continue;
+
+		Visit(root);
+
+		while(!call_stack.empty()){
+			int node = call_stack.back().node;
+			auto& successors = graph.successors[node];
+
+			if(call_stack.back().next_successor < successors.size()){
+				int next = successors[call_stack.back().next_successor++];
+
+				if(index[next] == -1) 
+					Visit(next);
+				else if(on_stack[next]) 
+					low_link[node] = std::min(low_link[node], index[next]);
+
+				continue;
+			}
+
+			call_stack.pop_back();
+			if(!call_stack.empty()){
+				int parent = call_stack.back().node;
+				low_link[parent] = std::min(low_link[parent], low_link[node]);
+			}
+
+			if(low_link[node] != index[node]) continue;
+
+			// node is root of component
+			std::vector<int> component;
+			int member;
+			do{
+				member = stack.back();
+				stack.pop_back();
+				on_stack[member] = false;
+				component.push_back(member);
+			}while(member != node);
+
+			bool is_loop = component.size() > 1;
+			if(!is_loop){
+				is_loop = std::find(successors.begin(), successors.end(), node) != successors.end();
+			}
+
+			if(!is_loop) continue;
+
+			// store block ids in execution order 
+			std::sort(component.begin(), component.end());
+			std::vector<int> loop;
+			for(int n: component){
+				loop.push_back(graph.nodes[n]->id);
+				feedback_loop_blocks[graph.nodes[n]->id] = feedback_loops.size();
+			}
+			feedback_loops.push_back(loop);
+		}
+	}
+}
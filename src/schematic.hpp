@@ -2,15 +2,21 @@
 
 #include <list>
 #include <memory>
+#include <unordered_map>
+#include <unordered_set>
 #include <string>
 #include <fstream>
 #include <boost/json.hpp>
 #include <filesystem>
 #include <variant>
 #include <inttypes.h>
+#include <cstdio>
+#include <functional>
 
 #include "schematic_block.hpp"
 #include "librarian.hpp"
+#include "code_writer.hpp"
+#include "schematic_binary.hpp"
 
 
 class Schematic {
@@ -24,6 +30,7 @@ public:
 		int id;
 		std::string full_name;
 		struct Pos { int x; int y; } pos;
+		int task = 0; // index in Schematic::tasks
 
 		std::vector<std::variant<std::monostate, bool, int64_t, double, std::string>> parameters;
 
@@ -91,7 +98,21 @@ public:
 	};
 
 
-private:
+	// multi-rate execution - blocks of task run every 'period' base cycles, when
+	// cycle % period == offset. due tasks run one after another, highest priority first,
+	// so task always reads outputs of last completed run of other tasks.
+	// task 0 always exists and holds every block not assigned elsewhere.
+	struct Task {
+		std::string name;
+		int period = 1;   // in base cycles (PLC::LoopStart calls)
+		int offset = 0;   // 0 .. period-1, spreads slow tasks over different cycles
+		int priority = 0; // higher runs first
+
+		bool IsValid() const { return period >= 1 && offset >= 0 && offset < period; }
+	};
+
+
+	// connection as stored in file, before blocks are resolved
 	struct ConnectionRaw {
 		int src;
 		int src_pin;
@@ -110,14 +131,79 @@ private:
 	};
 
 
+private:
 	int next_block_id;
 	int next_connection_id;
 
 
+	// graph index 
+	// 
+	// blocks and connections are still stored in lists (order of blocks is execution order)
+	// index below allows to find blocks and pin connections without iterating over lists.
+	// pointers to list elements are stable, so they can be stored in index directly.
+	//
+	struct BlockLinks {
+		std::vector<Connection*> inputs;  // indexed by dst_pin, nullptr - pin not connected
+		std::vector<Connection*> outputs; // every connection starting in block
+	};
+
+	std::unordered_map<int, std::shared_ptr<Block>> block_index;
+	std::unordered_map<int, std::list<Connection>::iterator> connection_index;
+	std::unordered_map<int, BlockLinks> links_index;
+
+	void IndexConnection(std::list<Connection>::iterator iter);
+	void UnindexConnection(Connection* conn);
+
+
+	// execution graph - valid blocks numbered in current order
+	struct ExecutionGraph {
+		std::vector<std::shared_ptr<Block>> nodes;
+		std::vector<std::vector<int>> successors; // one entry per connection
+		std::vector<int> input_count;             // number of connected inputs
+	};
+
+	ExecutionGraph BuildExecutionGraph();
+
+	std::vector<std::vector<int>> feedback_loops; // block ids of every loop
+	std::unordered_map<int, int> feedback_loop_blocks; // block id -> index of its loop
+
+	void GroupFeedbackLoops();
+
+	bool InSameLoop(int block_a, int block_b){
+		auto a = feedback_loop_blocks.find(block_a);
+		auto b = feedback_loop_blocks.find(block_b);
+		return a != feedback_loop_blocks.end() && b != feedback_loop_blocks.end() && a->second == b->second;
+	}
+
+
+	// incremental execution order (Pearce-Kelly dynamic topological order)
+	//
+	// every block has order number (ord) that grows with position in 'blocks' list.
+	// when new connection breaks the order, only blocks between source and destination
+	// are reordered. blocks of every feedback loop stay together (see SortBlocks), so loops
+	// don't prevent reordering of other blocks. connection which touches a loop, creates a new
+	// one or removes connection inside a loop requires full sort (order_dirty).
+	//
+	struct OrderEntry {
+		int ord;
+		std::list<std::shared_ptr<Block>>::iterator position;
+	};
+
+	bool incremental_order = false;
+	bool order_dirty = true;
+	int next_ord = 0;
+	std::unordered_map<int, OrderEntry> order_index;
+
+	void RebuildOrderIndex();
+	void OrderAddBlock(std::list<std::shared_ptr<Block>>::iterator position);
+	void OrderAddConnection(const Connection* conn);
+
+
 public:
 
 	std::list<std::shared_ptr<Block>> blocks;
 	std::list<Connection> connetions;
+	std::vector<Task> tasks = {Task{"main"}};
 	std::filesystem::path path;
 	
 	
@@ -126,8 +212,42 @@ public:
 		next_connection_id = 1;
 	}
 
+	// task of block, unknown index falls back to task 0
+	int TaskOf(const Block& block) const { return block.task > 0 && block.task < tasks.size() ? block.task : 0; }
+
+	// tasks in order they run within one cycle
+	std::vector<int> TaskOrder() const;
+
+	// true when generated loop has to select due tasks, otherwise every block runs every cycle
+	bool IsMultiTask() const { return tasks.size() > 1 || tasks[0].period > 1; }
+
+	int AddTask(const Task& task){
+		tasks.push_back(task);
+		return tasks.size() - 1;
+	}
+
+	// blocks of removed task go to task 0, task 0 can't be removed
+	bool RemoveTask(int index){
+		if(index <= 0 || index >= tasks.size()) return false;
+		tasks.erase(tasks.begin() + index);
+		for(auto& block: blocks){
+			if(block->task == index) block->task = 0;
+			else if(block->task > index) block->task--;
+		}
+		return true;
+	}
+
+	bool SetBlockTask(int block_id, int task){
+		auto block = FindBlock(block_id);
+		if(!block || task < 0 || task >= tasks.size()) return false;
+		block->task = task;
+		return true;
+	}
+
 	std::list<std::shared_ptr<Block>> Blocks(){return blocks;};
 	std::list<Connection> Connetions(){return connetions;};
+	size_t BlockCount(){return blocks.size();};
+	size_t ConnectionCount(){return connetions.size();};
 	std::filesystem::path Path(){return path;};
 
 	enum class Error {
@@ -159,6 +279,11 @@ public:
 		JSON_BLOCK_INVALID_LOC,
 		JSON_BLOCK_PARAMETER_INVALID_TYPE,
 		JSON_BLOCK_PARAMS_NOT_ARRAY,
+		JSON_BLOCK_INVALID_TASK,
+
+		JSON_TASKS_FIELD_NOT_ARRAY,
+		JSON_TASK_NOT_AN_OBJECT,
+		JSON_TASK_IS_INVALID,
 
 		JSON_CONNECTION_NOT_AN_OBJECT,
 		JSON_CONNECTION_IS_INVALID,
@@ -167,6 +292,16 @@ public:
 		JSON_CONNECTION_INVALID_DST,
 		JSON_CONNECTION_INVALID_DSTPIN,
 
+		BINARY_INVALID_HEADER,
+		BINARY_UNSUPPORTED_VERSION,
+		BINARY_TRUNCATED,
+		BINARY_INVALID_BLOCK,
+		BINARY_INVALID_CONNECTION,
+		BINARY_INVALID_PARAMETER,
+		BINARY_INVALID_TASK,
+
+		BLOCK_CODE_NOT_GENERATED,
+
 	};
 
 
@@ -178,59 +313,82 @@ private:
 		auto dst1 = conn1->dst.lock();
 		if(!dst1) return false; // not connected to anything
 
-		for(auto iter = connetions.begin(); iter != connetions.end(); /*none*/){
-			const Connection* conn2 = &(*iter);
+		Connection* conn2 = FindInputConnection(dst1->id, conn1->dst_pin);
+		if(!conn2) return false; // pin is free
+		if(conn2 == conn1) return false; // skip same connection
+		
+		return true; // connected to same block and pin
+	}
 
-			if(conn2 == conn1){
-				iter ++;
-				continue; // skip same connection
-			} 
 
+	std::vector<Connection> GetAllBlockInputConnections(std::shared_ptr<Block>);
 
-			auto dst2 = conn2->dst.lock();
+	
 
-			if(dst1 != dst2){
-				iter++;
-				continue; // not connected to same block
-			}
+public:
 
-			if(conn1->dst_pin != conn2->dst_pin){
-				iter++;
-				continue; // not connected to same pin
-			} 
 
-			return true; // connected to same block and pin
-		}
+	void SortBlocks();
 
-		return false;
+	// find every feedback loop (strongly connected component) in schematic
+	// SortBlocks() calls this function automatically
+	void FindFeedbackLoops();
 
+	std::vector<std::vector<int>> FeedbackLoops(){ return feedback_loops; }
+	bool IsInFeedbackLoop(int block_id){ return feedback_loop_blocks.count(block_id) != 0; }
+
+	// enable/disable updating execution order on every change in schematic
+	void SetIncrementalOrder(bool enable){
+		if(enable && !incremental_order) order_dirty = true;
+		if(!enable) order_index.clear(); // order is changed without index (manual order), positions would be stale
+		incremental_order = enable;
 	}
 
+	// make execution order valid after changes in schematic
+	// full sort is done only if order could not be updated incrementally
+	void UpdateOrder(){
+		if(!incremental_order) return;
+		if(order_dirty) SortBlocks();
+	}
 
-	std::vector<Connection> GetAllBlockInputConnections(std::shared_ptr<Block>);
 
-	
+	std::shared_ptr<Block> FindBlock(int id){
+		auto iter = block_index.find(id);
+		if(iter == block_index.end()) return nullptr;
+		return iter->second;
+	}
 
-public:
+	// returns connection connected to input pin or nullptr if pin is not connected
+	Connection* FindInputConnection(int block_id, int pin){
+		auto iter = links_index.find(block_id);
+		if(iter == links_index.end()) return nullptr;
+		if(pin < 0 || pin >= iter->second.inputs.size()) return nullptr;
+		return iter->second.inputs[pin];
+	}
 
+	// returns all connections starting in block
+	std::vector<Connection*> FindOutputConnections(int block_id){
+		auto iter = links_index.find(block_id);
+		if(iter == links_index.end()) return {};
+		return iter->second.outputs;
+	}
 
-	void SortBlocks();
+	// rebuild whole index from lists
+	// call this after modifying 'blocks' or 'connetions' list directly
+	void RebuildIndex();
 
 
 	bool CreateConnection(int src_id, int src_pin, int dst_id, int dst_pin){
 
 		// find src and dst block;
-		std::shared_ptr<Block> src = nullptr;
-		std::shared_ptr<Block> dst = nullptr;
-		
-		for(auto b: blocks){
-			if(b->id == src_id) src = b;
-			if(b->id == dst_id) dst = b;
-		};
+		std::shared_ptr<Block> src = FindBlock(src_id);
+		std::shared_ptr<Block> dst = FindBlock(dst_id);
 		
 		Connection conn(next_connection_id++, src, src_pin, dst, dst_pin);
 		if (conn.IsValid() && !IsConnectedToAlreadyConnectedPin(&conn)) {
 			connetions.push_back(conn);
+			IndexConnection(std::prev(connetions.end()));
+			OrderAddConnection(&connetions.back());
 			return true;
 		}
 		else { 
@@ -240,6 +398,78 @@ public:
 	}
 
 
+	bool RemoveConnection(int id){
+		auto iter = connection_index.find(id);
+		if(iter == connection_index.end()) return false;
+
+		auto conn_iter = iter->second;
+		auto src = conn_iter->src.lock();
+		auto dst = conn_iter->dst.lock();
+		if(src && dst && InSameLoop(src->id, dst->id)) order_dirty = true; // loop may be broken
+
+		UnindexConnection(&(*conn_iter));
+		connetions.erase(conn_iter);
+		return true;
+	}
+
+
+	// removes block and every connection connected to it
+	bool RemoveBlock(int id){
+		auto iter = block_index.find(id);
+		if(iter == block_index.end()) return false;
+
+		std::shared_ptr<Block> block = iter->second;
+
+		auto links_iter = links_index.find(id);
+		if(links_iter != links_index.end()){
+			std::vector<int> conn_ids;
+			for(Connection* c: links_iter->second.inputs) if(c) conn_ids.push_back(c->id);
+			for(Connection* c: links_iter->second.outputs) conn_ids.push_back(c->id);
+
+			for(int conn_id: conn_ids) RemoveConnection(conn_id);
+			links_index.erase(id);
+		}
+
+		auto order_iter = order_index.find(id);
+		if(order_iter != order_index.end() && *order_iter->second.position == block){
+			blocks.erase(order_iter->second.position);
+			order_index.erase(order_iter);
+		}else{
+			blocks.remove(block);
+			if(order_iter != order_index.end()){
+				order_index.erase(order_iter);
+				order_dirty = true;
+			}
+		}
+
+		block_index.erase(iter);
+		return true;
+	}
+
+
+	// manual execution order, 'a', 'b', 'from' and 'to' are positions in 'blocks'
+	void SwapBlocks(std::list<std::shared_ptr<Block>>::iterator a, std::list<std::shared_ptr<Block>>::iterator b){
+		std::swap(*a, *b);
+		RebuildOrderIndex();
+	}
+
+	// 'from' is placed at position of 'to', blocks between them are shifted
+	void MoveBlock(std::list<std::shared_ptr<Block>>::iterator from, std::list<std::shared_ptr<Block>>::iterator to){
+		if(from == to) return;
+
+		// check which element is first
+		bool source_first = false;
+		for(auto iter = blocks.begin(); iter != blocks.end(); iter++){
+			if(iter == from){ source_first = true; break; }
+			if(iter == to) break;
+		}
+
+		if(source_first) to++;
+		blocks.splice(to, blocks, from); // 'from' stays valid, order index is rebuilt anyway
+		RebuildOrderIndex();
+	}
+
+
 	std::shared_ptr<Block> CreateBlock(std::shared_ptr<BlockData> block_data, int x, int y){
 		if(block_data == nullptr) return 0;
 
@@ -253,6 +483,8 @@ public:
 		auto block_ptr = std::make_shared<Block>(b);
 	
 		blocks.push_back(block_ptr);
+		block_index[block_ptr->id] = block_ptr;
+		OrderAddBlock(std::prev(blocks.end()));
 
 		return block_ptr;
 	}
@@ -301,10 +533,14 @@ public:
 			}
 		);
 
+		RebuildIndex();
+
 		// remove multiple connections connected to single input
+		// (index keeps only last connection connected to each pin)
 		for(auto iter = connetions.begin(); iter != connetions.end(); /*none*/){
 			Connection& conn = *iter;
 			if(IsConnectedToAlreadyConnectedPin(&conn)){
+				UnindexConnection(&conn);
 				iter = connetions.erase(iter);
 			}else{
 				iter++;
@@ -332,7 +568,11 @@ public:
 		std::string data;
 		Error err;
 
-		err = Serialize(&data);
+		// file format is selected by extension
+		if(IsBinaryPath(path))
+			err = SerializeBinary(&data);
+		else
+			err = Serialize(&data);
 		if(err != Error::OK) return err;
 
 		err = SaveFile(path, data);
@@ -340,21 +580,248 @@ public:
 	}
 
 
+	// code generation modes, shared by all BuildToCPP variants
+	struct CodeOptions {
+		bool signal_table = false; // block outputs stored in one table ordered by execution order, inputs are never null
+		bool optimize = true;      // remove unused pure blocks and fold constant logic (see OptimizeCode)
+		bool constant_parameters = false; // bool/int64_t/double parameters are compile time constants of templated block classes
+		bool packed_logic = false; // connected and/or/not/RS/D blocks evaluated as bitwise operations on uint64_t words (see PlanLogicNetworks)
+		int workers = 1;           // >1 - independent parts of every cycle are updated by pool of threads (see PlanParallel)
+		bool change_driven = false; // pure blocks updated only when some input changed (see PlanChangeDriven), program runs on single thread
+	};
+	void SetCodeOptions(const CodeOptions& options){ code_options = options; }
+	const CodeOptions& GetCodeOptions() const { return code_options; }
+
+	// what optimization pass changed in last generated code
+	struct CodeReport {
+		std::vector<int> removed_blocks;  // pure blocks whose outputs never reach block with side effects
+		std::vector<int> folded_blocks;   // blocks replaced by constant outputs
+		int blocks_without_init = 0;      // emitted blocks with empty init(), call is skipped
+		int packed_blocks = 0;            // blocks evaluated inside boolean networks
+		int logic_networks = 0;
+
+		// parallel execution, filled when CodeOptions::workers > 1
+		struct Part { int phase; int worker; };    // worker -1 - serial phase run by main thread
+		std::unordered_map<int, Part> partition;  // block id -> part
+		int workers = 1;                          // threads used by generated program, 1 - serial fallback
+		int parallel_phases = 0;
+		double expected_speedup = 0.0;            // estimated from block counts, 0 - not planned
+
+		// multi-rate tasks in order they run within cycle, empty - every block runs every cycle
+		struct TaskLoad { std::string name; int period; int offset; int priority; int blocks; };
+		std::vector<TaskLoad> tasks;
+
+		int change_driven_blocks = 0;             // pure blocks updated only when marked dirty
+
+		// memory blocks
+		int memory_addresses = 0;                 // distinct addresses of all value types
+		std::vector<int> unwritten_memory_reads;  // read blocks whose address no block writes, they read zero
+
+		std::string ToString() const {
+			auto IdList = [](const std::vector<int>& ids){
+				std::string str;
+				for(int id: ids) str += " " + std::to_string(id);
+				return str;
+			};
+			return "removed " + std::to_string(removed_blocks.size()) + " unused blocks:" + IdList(removed_blocks) + "\n"
+				 + "folded " + std::to_string(folded_blocks.size()) + " constant blocks:" + IdList(folded_blocks) + "\n"
+				 + "skipped " + std::to_string(blocks_without_init) + " empty init() calls\n"
+				 + "packed " + std::to_string(packed_blocks) + " boolean blocks into " + std::to_string(logic_networks) + " networks"
+				 + (change_driven_blocks == 0 ? "" : "\nchange-driven: " + std::to_string(change_driven_blocks) + " pure blocks updated only when input changes")
+				 + (expected_speedup == 0.0 ? "" : "\n" + ParallelToString())
+				 + (tasks.empty() ? "" : "\n" + TasksToString())
+				 + (memory_addresses == 0 ? "" : "\n" + MemoryToString());
+		}
+
+		std::string MemoryToString() const {
+			std::string str = "memory: " + std::to_string(memory_addresses) + " addresses";
+			if(!unwritten_memory_reads.empty()){
+				str += ", " + std::to_string(unwritten_memory_reads.size()) + " blocks read never written address:";
+				for(int id: unwritten_memory_reads) str += " " + std::to_string(id);
+			}
+			return str;
+		}
+
+		std::string TasksToString() const {
+			std::string str = "tasks:";
+			for(const auto& t: tasks)
+				str += "\n  " + t.name + " - every " + std::to_string(t.period) + " cycles (offset " + std::to_string(t.offset)
+					+ ", priority " + std::to_string(t.priority) + "), " + std::to_string(t.blocks) + " blocks";
+			return str;
+		}
+
+		std::string ParallelToString() const {
+			char speedup[32];
+			std::snprintf(speedup, sizeof(speedup), "%.2f", expected_speedup);
+			if(workers < 2) return std::string("parallel: serial, expected speedup ") + speedup + " is too low";
+			return "parallel: " + std::to_string(workers) + " workers, " + std::to_string(parallel_phases) + " parallel phases, expected speedup " + speedup;
+		}
+	};
+	const CodeReport& GetCodeReport() const { return code_report; }
+	const CodeReport& AnalyzeCode(); // run optimization and partitioning with current options without generating code
+
 	std::string BuildToCPP();
+	void BuildToCPP(std::ostream& sink); // stream generated code, e.g. directly into a file
+
+	// same program split into translation units: "file1.cpp" with instances and main()
+	// plus one "<class>.hpp" / "<class>.cpp" pair per library block class
+	// 'files' is empty if class of any used block can't be generated (e.g. missing code file)
+	Error BuildToCPPFiles(std::vector<CodeFile>* files);
+	void ClearCodeCache(){ class_cache.clear(); }
 
 
 	Error Read(const std::filesystem::path& _path);
 
+	static bool IsBinaryPath(const std::filesystem::path& p){ return p.extension() == SchematicBinary::EXTENSION; }
+
 private:
 
 	bool CodeExtractSection(const std::string& code, std::string* result, const std::string& marker);
+	static std::string CodeClassName(const std::string& full_name);
+	static bool IsConstantParameterType(const std::string& type){ return type == "bool" || type == "int64_t" || type == "double"; }
+	static bool HasConstantParameters(const std::shared_ptr<BlockData>& block_lib);
+	void WriteBlockType(CodeWriter& out, const Block& block, const std::unordered_map<const BlockData*, std::string>& class_names);
+	static void WriteParameterValue(CodeWriter& out, const std::string& type, const Block& block, int i);
+	void BuildToCPP(CodeWriter& out, bool split_files);
+	void BuildBlockInstances(CodeWriter& out, const std::unordered_map<const BlockData*, std::string>& class_names);
+	void BuildSignalTable(CodeWriter& out, const std::unordered_map<const BlockData*, std::string>& class_names);
+	std::vector<std::shared_ptr<BlockData>> UsedLibraryBlocks();
+
+	// generated code of single library block class
+	struct BlockClassCode {
+		std::string name;   // class name, also used as file name in split mode
+		std::string code;   // whole class for single file output
+		std::string header; // class declaration for split output
+		std::string source; // init() and update() definitions for split output
+		bool has_init = true; // init() body is not empty
+		bool is_template = false; // class takes constant parameters as template argument
+	};
+
+	// generated block classes, reused between builds while the block's .cpp file 
+	// (modification time + size), its inputs/parameters/outputs and code options are unchanged
+	struct ClassCacheEntry {
+		std::filesystem::file_time_type code_time;
+		uintmax_t code_size = 0;
+		std::string io_signature;
+		BlockClassCode code;
+	};
+	std::unordered_map<std::string, ClassCacheEntry> class_cache;
+	CodeOptions code_options;
+	CodeReport code_report;
+
+	// result of optimization pass used while code is emitted
+	struct CodePlan {
+		std::unordered_set<int> removed;              // blocks not emitted (dead or folded)
+		std::unordered_map<int64_t, bool> constants;  // folded outputs, key: PinKey(block id, pin)
+
+		static int64_t PinKey(int id, int pin){ return ((int64_t)id << 32) | (uint32_t)pin; }
+		bool IsRemoved(int id) const { return removed.count(id) != 0; }
+		const bool* Constant(int id, int pin) const {
+			auto iter = constants.find(PinKey(id, pin));
+			return iter == constants.end() ? nullptr : &iter->second;
+		}
+
+		// boolean networks - every signal is one bit of 'logic_N' array, chunk of up to 64 blocks
+		// of the same kind and depth is evaluated by single bitwise expression
+		enum class LogicKind { AND, OR, NOT, RS, D };
+
+		struct LogicChunk {
+			LogicKind kind;
+			int word;             // Q outputs, bit i belongs to blocks[i], nQ is inverted Q
+			int state_word = -1;  // previous clk of D blocks
+			std::vector<int> blocks;
+
+			int InputCount() const { return kind == LogicKind::NOT ? 1 : 2; }
+			const char* KindName() const {
+				switch(kind){
+				case LogicKind::AND: return "and";
+				case LogicKind::OR:  return "or";
+				case LogicKind::NOT: return "not";
+				case LogicKind::RS:  return "RS";
+				case LogicKind::D:   return "D";
+				}
+				return "";
+			}
+		};
+
+		struct LogicNetwork {
+			int first_block;                // network is evaluated in place of this block
+			int words = 0;
+			std::vector<LogicChunk> chunks; // in evaluation order
+			std::vector<int64_t> outputs;   // PinKeys read outside of network
+		};
+
+		struct LogicBit { int network; int word; int bit; bool inverted; };
+
+		std::vector<LogicNetwork> networks;
+		std::unordered_map<int, int> logic_blocks;        // block id -> network
+		std::unordered_map<int64_t, LogicBit> logic_bits; // key: PinKey(block id, pin)
+		std::unordered_map<int, int> order;               // block id -> position in execution order, filled with networks
+
+		bool IsEmitted(int id) const { return !IsRemoved(id) && logic_blocks.count(id) == 0; } // block has its own object
+		const LogicBit* Bit(int id, int pin) const {
+			auto iter = logic_bits.find(PinKey(id, pin));
+			return iter == logic_bits.end() ? nullptr : &iter->second;
+		}
+
+		// parallel execution - phases run one after another, parts of parallel phase run at once
+		struct Phase {
+			bool parallel;
+			int task = 0;                        // phases of one task follow each other, in order of task_order
+			std::vector<std::vector<int>> parts; // per worker, updated block ids (or first block of network) in execution order
+		};
+		std::vector<Phase> phases; // empty - serial program
+
+		std::vector<int> task_order; // tasks in order they run within cycle
+
+		// memory blocks - addresses used by schematic, one table per value type (see PlanMemory)
+		struct MemoryTable {
+			enum class Layout { DENSE, HASH, SEARCH } layout = Layout::DENSE;
+			std::vector<int64_t> addresses; // sorted
+			int size = 0;                   // slots, without scratch slot of unused addresses
+			uint64_t multiplier = 0;        // HASH: slot = address * multiplier >> (64 - bits)
+			int bits = 0;
+		};
+		MemoryTable memory[3];              // bool, int64_t, double
+		bool uses_memory = false;
+
+		// change-driven execution - dirty bit of every pure block in 'plc_dirty'
+		std::unordered_map<int, int> dirty_index; // block id -> bit
+		int dirty_count = 0;
+	};
+	CodePlan code_plan;
+
+	void OptimizeCode(); // fills code_plan and code_report
+	void PlanTasks();         // fills task order of code_plan, after OptimizeCode
+	void PlanMemory();        // fills memory tables of code_plan, after OptimizeCode
+	void PlanChangeDriven();  // fills dirty bits of code_plan, after PlanLogicNetworks
+	void PlanLogicNetworks(); // fills boolean networks of code_plan, after OptimizeCode
+	void PlanParallel();      // fills phases of code_plan, after PlanLogicNetworks
+	void WriteBlockUpdate(CodeWriter& out, int id);
+	bool WriteTaskBegin(CodeWriter& out, int task);
+	void WriteMemory(CodeWriter& out);
+	void WriteChangeDriven(CodeWriter& out, int id, const std::vector<int64_t>& outputs, const std::function<void()>& update);
+	void WriteWorkerParts(CodeWriter& out);
+	void WriteSignal(CodeWriter& out, int id, int pin);
+	void WriteLogicDeclarations(CodeWriter& out);
+	void WriteLogicUpdate(CodeWriter& out, int network);
+	void WriteLogicOutputs(CodeWriter& out, int network, const char* indent);
+
+	const BlockClassCode* GetBlockClass(const std::shared_ptr<BlockData>& block_lib);
+	bool BuildBlockClass(const std::shared_ptr<BlockData>& block_lib, BlockClassCode* result);
 
     Error SaveFile(const std::filesystem::path& _path, const std::string& data);
     Error LoadFile(const std::filesystem::path& path, std::string* result);
 
 	Error ParseJson(const std::string& data_str);
-	Error ParseJsonBlock(const boost::json::value& js, Block* block);
-	Error ParseJsonConnection(const boost::json::value& js, ConnectionRaw* conn);
+
+	Error ReadBinary(const std::filesystem::path& _path);
+	Error ParseBinary(const char* data, size_t size);
+	void FinishLoading();
+
+public:
+
+	Error SerializeBinary(std::string* data);
 
 	Error Serialize(std::string* data) {
 
@@ -367,6 +834,7 @@ private:
 			js_block["id"] = block_ptr->id;
 			js_block["pos"] = boost::json::array({block_ptr->pos.x, block_ptr->pos.y });
 			js_block["name"] = block_ptr->GetFullName();
+			if(TaskOf(*block_ptr) != 0) js_block["task"] = TaskOf(*block_ptr);
 			if(block_ptr->parameters.size()){
 
 				boost::json::array js_param_arr;
@@ -412,6 +880,20 @@ private:
 		js["blocks"] = js_blocks;
 		js["connections"] = js_connections;
 
+		// only schematics using tasks store them, default is single "main" task
+		if(IsMultiTask() || tasks[0].name != "main"){
+			boost::json::array js_tasks;
+			for(const auto& task: tasks){
+				boost::json::object js_task;
+				js_task["name"] = task.name;
+				js_task["period"] = task.period;
+				js_task["offset"] = task.offset;
+				js_task["priority"] = task.priority;
+				js_tasks.push_back(js_task);
+			}
+			js["tasks"] = js_tasks;
+		}
+
 		*data = boost::json::serialize(js);
 
 		return Error::OK;
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <bit>
+
+
+
+// Binary schematic file (".schematicb")
+//
+// Same content as json ".schematic" file, stored as fixed size records, so file can be
+// memory mapped and read without parsing. All numbers are little endian (host order,
+// only little endian hosts are supported).
+//
+//  ┌──────────────────────┐
+//  │ Header               │  32 B
+//  ├──────────────────────┤
+//  │ BlockRecord[]        │  32 B * block_count
+//  ├──────────────────────┤
+//  │ ConnectionRecord[]   │  16 B * connection_count
+//  ├──────────────────────┤
+//  │ ParameterRecord[]    │  16 B * parameter_count
+//  ├──────────────────────┤
+//  │ TaskRecord[]         │  24 B * task_count
+//  ├──────────────────────┤
+//  │ string table         │  string_table_size B  (block and task names, string parameters, not terminated)
+//  └──────────────────────┘
+//
+// Version 1 files have no tasks (task_count and BlockRecord::task were reserved, always 0).
+//
+namespace SchematicBinary {
+
+    static constexpr char MAGIC[8] = {'P','L','C','S','C','H','B','\0'};
+    static constexpr uint32_t VERSION = 2;
+    static constexpr uint32_t MIN_VERSION = 1; // oldest version still readable
+    static constexpr const char* EXTENSION = ".schematicb";
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t block_count;
+        uint32_t connection_count;
+        uint32_t parameter_count;
+        uint32_t string_table_size;
+        uint32_t task_count;        // 0 - only default task
+    };
+
+    struct BlockRecord {
+        int32_t id;
+        int32_t x;
+        int32_t y;
+        uint32_t name_offset;       // in string table
+        uint32_t name_size;
+        uint32_t first_parameter;   // index of first ParameterRecord
+        uint32_t parameter_count;
+        uint32_t task;              // index of TaskRecord
+    };
+
+    struct ConnectionRecord {
+        int32_t src;
+        int32_t src_pin;
+        int32_t dst;
+        int32_t dst_pin;
+    };
+
+    enum class ParameterType: uint32_t { NONE, BOOL, INT64, DOUBLE, STRING };
+
+    struct ParameterRecord {
+        ParameterType type;
+        uint32_t reserved;
+        union {
+            uint64_t boolean;       // 0 or 1
+            int64_t int64;
+            double real;
+            struct { uint32_t offset; uint32_t size; } string;  // in string table
+        };
+    };
+
+    struct TaskRecord {
+        uint32_t name_offset;       // in string table
+        uint32_t name_size;
+        int32_t period;
+        int32_t offset;
+        int32_t priority;
+        uint32_t reserved;
+    };
+
+    static_assert(sizeof(Header) == 32);
+    static_assert(sizeof(BlockRecord) == 32);
+    static_assert(sizeof(ConnectionRecord) == 16);
+    static_assert(sizeof(ParameterRecord) == 16);
+    static_assert(sizeof(TaskRecord) == 24);
+
+    // records are copied and mapped in host byte order
+    static_assert(std::endian::native == std::endian::little, "binary schematic format requires little endian host");
+
+
+    inline bool HasMagic(const char* data, size_t size){
+        return size >= sizeof(MAGIC) && std::memcmp(data, MAGIC, sizeof(MAGIC)) == 0;
+    }
+
+}
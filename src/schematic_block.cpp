@@ -1,4 +1,5 @@
 #include "schematic_block.hpp"
+#include "json_sax.hpp"
 
 
 const char* BlockData::ErrorToStr(Error err) {
@@ -110,6 +111,7 @@ BlockData::Error BlockData::SerializeJson(std::string* data){
     js.insert(boost::json::object::value_type("inputs", js_inputs));
     js.insert(boost::json::object::value_type("parameters",js_parameters));
     js.insert(boost::json::object::value_type("outputs",js_outputs));
+    if(pure) js["pure"] = true;
 
     *data = boost::json::serialize(js);
 
@@ -172,171 +174,189 @@ BlockData::Error BlockData::LoadFile(const std::filesystem::path &_path, std::st
 
 
 
-BlockData::Error BlockData::ParseJson(const std::string &str)
-{
+namespace {
 
-    std::error_code err;
-    //                                          // just to make things simple in future
-    boost::json::parse_options parse_opt;   //
-    parse_opt.allow_comments = true;        // 1) allow comments in json
-    parse_opt.allow_trailing_commas = true; // 2) allow trailing commas
+enum class BlockJsonCtx { ROOT, SKIP, DOCUMENT, IO_LIST, IO };
 
-    boost::json::value js = boost::json::parse(str, err, {}, parse_opt);
 
-    if (err)
-        return Error::JSON_PARSING_ERROR;
+// Streaming loader of block descriptor (.json). Errors are resolved after whole document 
+// was read, in the same order as fields were checked by DOM based loader: 
+// title, inputs, parameters, outputs.
+class BlockJsonHandler: public JsonSax::Handler<BlockJsonHandler, BlockJsonCtx> {
 
-    if (!js.is_object())
-        return Error::JSON_NOT_AN_OBJECT;
-    auto js_obj = js.as_object();
+    using Ctx = BlockJsonCtx;
+    using Error = BlockData::Error;
 
-    // 'name' field
-    if (auto js_title = js_obj.if_contains("title"))
-    {
-        if (auto str = js_title->if_string())
-        {
+    // error codes of single IO list
+    struct ListErrors {
+        Error missing_field, not_array, el_not_object, el_missing_label, el_missing_type, el_label_not_string, el_type_not_string;
+    };
 
-            title = *str;
-        }
-        else
-            return Error::JSON_NAME_NOT_A_STRING;
-    }
-    else
-        return Error::JSON_MISSING_NAME_FIELD;
+    static constexpr const char* list_names[3] = {"inputs", "parameters", "outputs"};
+    static constexpr ListErrors list_errors[3] = {
+        {Error::JSON_MISSING_INPUTS_FIELD, Error::JSON_INPUTS_NOT_AN_ARRAY, Error::JSON_INPUTS_EL_NOT_AN_OBJECT,
+         Error::JSON_INPUTS_EL_MISSING_LABEL, Error::JSON_INPUTS_EL_MISSING_TYPE,
+         Error::JSON_INPUTS_EL_LABEL_NOT_A_STRING, Error::JSON_INPUTS_EL_TYPE_NOT_A_STRING},
+        {Error::JSON_MISSING_PARAMETERS_FIELD, Error::JSON_PARAMETERS_NOT_AN_ARRAY, Error::JSON_PARAMETERS_EL_NOT_AN_OBJECT,
+         Error::JSON_PARAMETERS_EL_MISSING_LABEL, Error::JSON_PARAMETERS_EL_MISSING_TYPE,
+         Error::JSON_PARAMETERS_EL_LABEL_NOT_A_STRING, Error::JSON_PARAMETERS_EL_TYPE_NOT_A_STRING},
+        {Error::JSON_MISSING_OUTPUTS_FIELD, Error::JSON_OUTPUTS_NOT_AN_ARRAY, Error::JSON_OUTPUTS_EL_NOT_AN_OBJECT,
+         Error::JSON_OUTPUTS_EL_MISSING_LABEL, Error::JSON_OUTPUTS_EL_MISSING_TYPE,
+         Error::JSON_OUTPUTS_EL_LABEL_NOT_A_STRING, Error::JSON_OUTPUTS_EL_TYPE_NOT_A_STRING},
+    };
 
-    // 'inputs' field
-    if (auto js_inputs = js_obj.if_contains("inputs"))
-    {
-        if (auto js_inputs_arr = js_inputs->if_array())
-        {
+    bool is_object = false;
+    Error title_error = Error::JSON_MISSING_NAME_FIELD;
+    Error errors[3];
+    int list = -1;  // IO list being parsed
 
-            // iterate over array
-            for (auto js_el : *js_inputs_arr)
-            {
+    // IO element being parsed
+    std::string label, type;
+    enum class Field { MISSING, STRING, NOT_STRING } label_state, type_state;
 
-                if (auto js_el_obj = js_el.if_object())
-                {
+    static Field FieldState(const JsonSax::Value* v){
+        return (v && v->kind == JsonSax::Kind::STRING) ? Field::STRING : Field::NOT_STRING;
+    }
 
-                    auto js_label = js_el_obj->if_contains("label");
-                    auto js_type = js_el_obj->if_contains("type");
+    int ListIndex(){
+        for(int i = 0; i < 3; i++)
+            if(key == list_names[i]) return i;
+        return -1;
+    }
 
-                    if (!js_label)
-                        return Error::JSON_INPUTS_EL_MISSING_LABEL;
-                    if (!js_type)
-                        return Error::JSON_INPUTS_EL_MISSING_TYPE;
+    void SetError(Error e){
+        if(errors[list] == Error::OK) errors[list] = e;
+    }
 
-                    auto js_label_str = js_label->if_string();
-                    auto js_type_str = js_type->if_string();
+    void FinishIO(){
+        const ListErrors& le = list_errors[list];
+        if(label_state == Field::MISSING) SetError(le.el_missing_label);
+        else if(type_state == Field::MISSING) SetError(le.el_missing_type);
+        else if(label_state == Field::NOT_STRING) SetError(le.el_label_not_string);
+        else if(type_state == Field::NOT_STRING) SetError(le.el_type_not_string);
+        else if(errors[list] == Error::OK) result[list].emplace_back(label, type);
+    }
 
-                    if (!js_label_str)
-                        return Error::JSON_INPUTS_EL_LABEL_NOT_A_STRING;
-                    if (!js_type_str)
-                        return Error::JSON_INPUTS_EL_TYPE_NOT_A_STRING;
+public:
 
-                    std::string label = js_label_str->c_str();
-                    std::string type  = js_type_str->c_str();
+    std::string title;
+    std::vector<BlockData::IO> result[3];
+    bool pure = false;
 
-                    inputs.emplace_back(label, type);
-                }
-                else
-                    return Error::JSON_INPUTS_EL_NOT_AN_OBJECT;
-            }
-        }
-        else
-            return Error::JSON_INPUTS_NOT_AN_ARRAY;
+    BlockJsonHandler(){
+        for(int i = 0; i < 3; i++) errors[i] = list_errors[i].missing_field;
     }
-    else
-        return Error::JSON_MISSING_INPUTS_FIELD;
 
 
-    // 'parameters' field
-    if (auto js_parameters = js_obj.if_contains("parameters"))
-    {
-        if (auto js_parameters_arr = js_parameters->if_array())
-        {
+    Ctx Enter(Ctx parent, JsonSax::Kind kind){
+        const bool is_array = kind == JsonSax::Kind::ARRAY;
 
-            // iterate over array
-            for (auto js_el : *js_parameters_arr)
-            {
+        switch(parent){
+        case Ctx::ROOT:
+            is_object = !is_array;
+            return is_array ? Ctx::SKIP : Ctx::DOCUMENT;
 
-                if (auto js_el_obj = js_el.if_object())
-                {
+        case Ctx::DOCUMENT:
+            if(key == "title") title_error = Error::JSON_NAME_NOT_A_STRING;
+            list = ListIndex();
+            if(list < 0) return Ctx::SKIP;
+            result[list].clear();
+            errors[list] = is_array ? Error::OK : list_errors[list].not_array;
+            return is_array ? Ctx::IO_LIST : Ctx::SKIP;
 
-                    auto js_label = js_el_obj->if_contains("label");
-                    auto js_type = js_el_obj->if_contains("type");
+        case Ctx::IO_LIST:
+            if(is_array){
+                SetError(list_errors[list].el_not_object);
+                return Ctx::SKIP;
+            }
+            label_state = type_state = Field::MISSING;
+            return Ctx::IO;
 
-                    if (!js_label)
-                        return Error::JSON_PARAMETERS_EL_MISSING_LABEL;
-                    if (!js_type)
-                        return Error::JSON_PARAMETERS_EL_MISSING_TYPE;
+        case Ctx::IO:
+            if(key == "label") label_state = Field::NOT_STRING;
+            else if(key == "type") type_state = Field::NOT_STRING;
+            return Ctx::SKIP;
 
-                    auto js_label_str = js_label->if_string();
-                    auto js_type_str = js_type->if_string();
+        default:
+            return Ctx::SKIP;
+        }
+    }
 
-                    if (!js_label_str)
-                        return Error::JSON_PARAMETERS_EL_LABEL_NOT_A_STRING;
-                    if (!js_type_str)
-                        return Error::JSON_PARAMETERS_EL_TYPE_NOT_A_STRING;
 
-                    std::string label = js_label_str->c_str();
-                    std::string type  = js_type_str->c_str();
+    void Leave(Ctx ctx){
+        if(ctx == Ctx::IO) FinishIO();
+    }
+
 
-                    parameters.emplace_back(label, type);
-                }
-                else
-                    return Error::JSON_PARAMETERS_EL_NOT_AN_OBJECT;
+    void OnValue(Ctx parent, const JsonSax::Value& v){
+        const bool is_string = v.kind == JsonSax::Kind::STRING;
+
+        switch(parent){
+        case Ctx::DOCUMENT:
+            if(key == "title"){
+                title_error = is_string ? Error::OK : Error::JSON_NAME_NOT_A_STRING;
+                if(is_string) title.assign(v.string);
+            }
+            else if(key == "pure"){
+                pure = v.kind == JsonSax::Kind::BOOL && v.boolean; // optional, false when not a bool
+            }
+            else if((list = ListIndex()) >= 0){
+                result[list].clear();
+                errors[list] = list_errors[list].not_array;
             }
+            break;
+
+        case Ctx::IO_LIST:
+            SetError(list_errors[list].el_not_object);
+            break;
+
+        case Ctx::IO:
+            if(key == "label"){
+                label_state = FieldState(&v);
+                if(is_string) label.assign(v.string);
+            }else if(key == "type"){
+                type_state = FieldState(&v);
+                if(is_string) type.assign(v.string);
+            }
+            break;
+
+        default:
+            break;
         }
-        else
-            return Error::JSON_PARAMETERS_NOT_AN_ARRAY;
     }
-    else
-        return Error::JSON_MISSING_PARAMETERS_FIELD;
 
 
-    // 'outputs' field
-    if (auto js_outputs = js_obj.if_contains("outputs"))
-    {
-        if (auto js_outputs_arr = js_outputs->if_array())
-        {
-
-            // iterate over array
-            for (auto js_el : *js_outputs_arr)
-            {
+    Error Result(){
+        if(!is_object) return Error::JSON_NOT_AN_OBJECT;
+        if(title_error != Error::OK) return title_error;
+        for(Error e: errors)
+            if(e != Error::OK) return e;
+        return Error::OK;
+    }
+};
 
-                if (auto js_el_obj = js_el.if_object())
-                {
+}
 
-                    auto js_label = js_el_obj->if_contains("label");
-                    auto js_type = js_el_obj->if_contains("type");
 
-                    if (!js_label)
-                        return Error::JSON_OUTPUTS_EL_MISSING_LABEL;
-                    if (!js_type)
-                        return Error::JSON_OUTPUTS_EL_MISSING_TYPE;
 
-                    auto js_label_str = js_label->if_string();
-                    auto js_type_str = js_type->if_string();
+BlockData::Error BlockData::ParseJson(const std::string &str)
+{
+    // parse json string, IO lists are collected directly by streaming parser
+    boost::json::basic_parser<BlockJsonHandler> parser(JsonSax::Options());
 
-                    if (!js_label_str)
-                        return Error::JSON_OUTPUTS_EL_LABEL_NOT_A_STRING;
-                    if (!js_type_str)
-                        return Error::JSON_OUTPUTS_EL_TYPE_NOT_A_STRING;
+    if (!JsonSax::Parse(parser, str))
+        return Error::JSON_PARSING_ERROR;
 
-                    std::string label = js_label_str->c_str();
-                    std::string type  = js_type_str->c_str();
+    BlockJsonHandler& h = parser.handler();
+    Error err = h.Result();
+    if (err != Error::OK)
+        return err;
 
-                    outputs.emplace_back(label, type);
-                }
-                else
-                    return Error::JSON_OUTPUTS_EL_NOT_AN_OBJECT;
-            }
-        }
-        else
-            return Error::JSON_OUTPUTS_NOT_AN_ARRAY;
-    }
-    else
-        return Error::JSON_MISSING_OUTPUTS_FIELD;
+    title = std::move(h.title);
+    inputs = std::move(h.result[0]);
+    parameters = std::move(h.result[1]);
+    outputs = std::move(h.result[2]);
+    pure = h.pure;
 
     return Error::OK;
 }
@@ -8,10 +8,6 @@
 #include <assert.h>
 #include <variant>
 #include <boost/json.hpp>
-#include <imgui.h>
-#include <imnodes.h>
-#include <imgui_internal.h>
-#include <misc/cpp/imgui_stdlib.h>
 
 
 
@@ -48,6 +44,9 @@ private:
     std::vector<IO> outputs;
     std::vector<IO> parameters;
 
+    bool pure = false;      // optional "pure" field of block .json - update() has no side effects (IO, memory, 
+                            // time, console) and outputs depend only on inputs, parameters and block state
+
 
     inline int max(int a, int b){
         return a > b ? a : b; 
@@ -65,6 +64,8 @@ public:
     void SetInputs(const std::vector<IO>& _inputs){ inputs = _inputs; };
     void SetOutputs(const std::vector<IO>& _outputs){ outputs = _outputs; };
     void SetParameters(const std::vector<IO>& _parameters){ parameters = _parameters; };
+    bool IsPure(){ return pure; };
+    void SetPure(bool _pure){ pure = _pure; };
 
     const std::string& Name(){return name;}
     const std::string FullName(){return name_prefix + "\\" + name;}
@@ -115,13 +116,13 @@ public:
     //           ▲
     //           └── 1 - output pin
 
-    static inline ImGuiID GetImnodeID(int id)                { return (id << 8);                    }
-    static inline ImGuiID GetImnodeInputID(int id, int pin)  { return (id << 8) |          (pin+1); }
-    static inline ImGuiID GetImnodeOutputID(int id, int pin) { return (id << 8) | (1<<7) | (pin+1); }
+    static inline unsigned GetImnodeID(int id)                { return (id << 8);                    }
+    static inline unsigned GetImnodeInputID(int id, int pin)  { return (id << 8) |          (pin+1); }
+    static inline unsigned GetImnodeOutputID(int id, int pin) { return (id << 8) | (1<<7) | (pin+1); }
 
-    static inline int ImnodeToID(ImGuiID id)                 { return (id >> 8);                          }
-    static inline int ImnodeToInputID(ImGuiID id)            { return (id & 0b10000000) ? -1 : (id & 0b01111111)-1; }
-    static inline int ImnodeToOutputID(ImGuiID id)           { return (id & 0b10000000) ? (id & 0b01111111)-1 : -1; }
+    static inline int ImnodeToID(unsigned id)                 { return (id >> 8);                          }
+    static inline int ImnodeToInputID(unsigned id)            { return (id & 0b10000000) ? -1 : (id & 0b01111111)-1; }
+    static inline int ImnodeToOutputID(unsigned id)           { return (id & 0b10000000) ? (id & 0b01111111)-1 : -1; }
 
 
     std::vector<std::variant<std::monostate, bool, int64_t, double, std::string>> SetupParameterMemoryTypes(){
@@ -139,159 +140,14 @@ public:
             else
                 param_mem.emplace_back<std::monostate>(std::monostate());
         }
-    }
 
-private:
-
-    void GetPinProperties(const IO& io, ImNodesPinShape* shape, ImColor* color ){
-
-        if(io.type == "bool"){                      // bool - blue circle
-            *color = ImColor(0, 69, 242);
-            *shape = ImNodesPinShape_Circle;
-        }else if(io.type == "int64_t"){             // int64_t - green/blue circle
-            *color = ImColor(0, 255, 89);
-            *shape = ImNodesPinShape_Circle;
-        }else if(io.type == "double"){              // double - yellow circle
-            *color = ImColor(166, 255, 0);
-            *shape = ImNodesPinShape_Circle;
-        }else if(io.type == "std::string"){         // std::string - purple circle
-            *color = ImColor(222, 0, 242);        
-            *shape = ImNodesPinShape_Circle;
-        }else{
-            *color = ImColor(150,150,150);          // other - grey triangle
-            *shape = ImNodesPinShape_Triangle;
-        }
+        return param_mem;
     }
 
-
 public:
 
-    int Render(int id, int execution_number ,std::vector<std::variant<std::monostate, bool, int64_t, double, std::string>>& param_memory){
-
-        int node_id = GetImnodeID(id);
-        int input_id = GetImnodeInputID(id, 0);
-        int output_id = GetImnodeOutputID(id, 0);
-
-        ImNodes::BeginNode(node_id);
-
-        // Title
-        // if(title.size() != 0){ // this feature does not work correctly
-            ImNodes::BeginNodeTitleBar();
-            ImGui::TextColored(ImColor(150,150,200), "#%d", execution_number);
-            ImGui::SameLine();
-            ImGui::TextUnformatted(title.c_str());
-            ImNodes::EndNodeTitleBar();
-        // }
-
-        // Inputs
-        ImGui::BeginGroup();
-            for(auto& i: inputs){
-                
-                ImColor color;
-                ImNodesPinShape shape;
-                GetPinProperties(i, &shape, &color);
-                ImNodes::PushColorStyle(ImNodesCol_Pin, color);
-                
-                ImNodes::BeginInputAttribute(input_id++, shape);
-                ImGui::Text(i.label.c_str());
-                ImNodes::EndInputAttribute();
-
-                ImNodes::PopColorStyle();
-            }
-        ImGui::EndGroup();
-
-        // Vertical Separator
-        if(inputs.size() && parameters.size()){
-            ImGui::SameLine();
-            ImGui::SeparatorEx(ImGuiSeparatorFlags_Vertical);
-        }
-        ImGui::SameLine();
-
-        // Parameters
-        ImGui::BeginGroup();
-            ImGui::PushItemWidth(parameter_element_width);
-            int param_id = 1;
-            if(param_memory.size() != parameters.size()) param_memory.resize(parameters.size());
-
-            for(int i = 0; i <parameters.size(); i++){
-                auto& p = parameters[i];
-                auto& p_mem = param_memory[i];
-
-                ImGui::PushID(param_id++);
-
-                if(p.type == "bool"){
-                    if(!std::holds_alternative<bool>(p_mem)) p_mem = false;
-
-                    bool& val = std::get<bool>(p_mem);
-                    int int_val = val ? 1 : 0;
-                    ImGui::SliderInt(p.label.c_str(), &int_val, 0, 1);
-                    val = int_val != 0;
-
-                }
-                else if(p.type == "int64_t"){
-                    if(!std::holds_alternative<int64_t>(p_mem)) p_mem = (int64_t) 0;
-                    ImGui::InputScalar(p.label.c_str(), ImGuiDataType_S64, &std::get<int64_t>(p_mem));
-
-                }
-                else if(p.type == "double"){
-                    if(!std::holds_alternative<double>(p_mem)) p_mem = (double) 0.0;
-                    double& val = std::get<double>(p_mem);
-
-                    const char* format = (val > 1000000.0) || (val < 1.0/1000000.0) ? "%.6e" : "%.6f";
-                    ImGui::InputDouble(p.label.c_str(), &val, 0, 0, format);
-
-                    if(ImGui::IsItemHovered()){
-                        std::stringstream ss;
-						ss << std::setprecision(18) << val;
-						std::string val = ss.str();
-                        ImGui::SetTooltip(val.c_str());
-                    }
-                }
-                else if(p.type == "std::string"){
-                    if(!std::holds_alternative<std::string>(p_mem)) p_mem = std::string("");
-                    ImGui::InputText(p.label.c_str(), &std::get<std::string>(p_mem));
-                }
-                else{
-                    ImGui::Text(p.label.c_str());
-                }
-                
-                ImGui::PopID();
-            }
-
-            ImGui::PopItemWidth();
-        ImGui::EndGroup();
-        
-        
-        // Vertical Separator
-        if((parameters.size() && outputs.size())|| (inputs.size()  && outputs.size())){
-            ImGui::SameLine();
-            ImGui::SeparatorEx(ImGuiSeparatorFlags_Vertical);
-        }
-        ImGui::SameLine();
-
-        
-        // Outputs
-        ImGui::BeginGroup();
-            for(auto& o: outputs){
-
-                ImColor color;
-                ImNodesPinShape shape;
-                GetPinProperties(o, &shape, &color);
-                ImNodes::PushColorStyle(ImNodesCol_Pin, color);
-
-                ImNodes::BeginOutputAttribute(output_id++, shape);
-                ImGui::Text(o.label.c_str());
-                ImNodes::EndOutputAttribute();
-
-                ImNodes::PopColorStyle();
-            }
-        ImGui::EndGroup();
-
-
-        ImNodes::EndNode();
-
-        return node_id;
-    }
+    // draw block as imnodes node, returns imnodes node id (implemented in schematic_block_render.cpp)
+    int Render(int id, int execution_number ,std::vector<std::variant<std::monostate, bool, int64_t, double, std::string>>& param_memory);
 
 
 
@@ -353,18 +209,20 @@ public:
     Error Read(const std::filesystem::path& _path);
 
 
+    std::filesystem::path CodePath(){ return path / (name + ".cpp"); }
+
     Error ReadCode(std::string* data){
         assert(data); // data ptr cannot be null;
 
         Error err;
-        err = LoadFile(path / (name + ".cpp"), data);
+        err = LoadFile(CodePath(), data);
 
         return err;
     }
 
     Error SaveCode(const std::string& data){
         Error err;
-        err = SaveFile(path / (name + ".cpp"), data);
+        err = SaveFile(CodePath(), data);
         return err;
     }
 
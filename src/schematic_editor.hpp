@@ -182,7 +182,21 @@ public:
                     auto block_data = block->lib_block.lock();
                     
                     if(block_data){
+                        // highlight blocks that are part of feedback loop
+                        bool is_in_loop = schematic->IsInFeedbackLoop(block->id);
+                        if(is_in_loop){
+                            ImNodes::PushColorStyle(ImNodesCol_TitleBar, IM_COL32(156, 51, 19, 255));
+                            ImNodes::PushColorStyle(ImNodesCol_TitleBarHovered, IM_COL32(190, 70, 30, 255));
+                            ImNodes::PushColorStyle(ImNodesCol_TitleBarSelected, IM_COL32(220, 90, 40, 255));
+                        }
+
                         int id = block_data->Render(block->id, execution_number, block->parameters);
+
+                        if(is_in_loop){
+                            ImNodes::PopColorStyle();
+                            ImNodes::PopColorStyle();
+                            ImNodes::PopColorStyle();
+                        }
                     }
                     execution_number++;
                 }
@@ -238,41 +252,31 @@ public:
                 if ( ImGui::IsWindowFocused(ImGuiFocusedFlags_RootAndChildWindows) && ImNodes::IsEditorHovered() && ImGui::IsKeyPressed(ImGuiKey_Delete)) {
 
                     // delete blocks 
-                    for (auto iter = schematic->blocks.begin(); iter != schematic->blocks.end(); /*none*/) {
-
+                    std::vector<int> blocks_to_delete;
+                    for (auto& block : schematic->blocks) {
                         // check if selected
-                        auto block = *iter;
                         int id = BlockData::GetImnodeID(block->id);
-                        if (ImNodes::IsNodeSelected(id)) {
-                            // delete selected 
-                            iter = schematic->blocks.erase(iter);
-                            is_updated = true;
-                        }
-                        else {
-                            iter++;
-                        }
+                        if (ImNodes::IsNodeSelected(id)) blocks_to_delete.push_back(block->id);
+                    }
+
+                    for (int id : blocks_to_delete) {
+                        // delete selected (with all connected links)
+                        schematic->RemoveBlock(id);
+                        is_updated = true;
                     }
 
                     // delete connections
-                    for (auto iter = schematic->connetions.begin(); iter != schematic->connetions.end(); /*none*/) {
+                    std::vector<int> connections_to_delete;
+                    for (auto& conn : schematic->connetions) {
+                        // check if selected or invalid
+                        if (ImNodes::IsLinkSelected(conn.id) || !conn.IsValid()) 
+                            connections_to_delete.push_back(conn.id);
+                    }
 
-                        
-                        auto conn = *iter;
-                        // check if selected
-                        if (ImNodes::IsLinkSelected(conn.id)) { 
-                            // delete selected 
-                            iter = schematic->connetions.erase(iter);
-                            is_updated = true;
-                        }
-                        // check if valid
-                        else if(!conn.IsValid()){
-                            // delete invalid 
-                            iter = schematic->connetions.erase(iter);
-                            is_updated = true;
-                        }
-                        else{
-                            iter++;
-                        }
+                    for (int id : connections_to_delete) {
+                        // delete selected/invalid 
+                        schematic->RemoveConnection(id);
+                        is_updated = true;
                     }
                 }
             }
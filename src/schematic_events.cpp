@@ -0,0 +1,89 @@
+#include "schematic.hpp"
+#include <vector>
+#include <string>
+#include <algorithm>
+
+
+
+// Change-driven execution (CodeOptions::change_driven)
+//
+// Every pure block has a dirty bit in 'plc_dirty'. Block is updated only when its bit is set,
+// then the bit is cleared. After every update outputs are compared with their values before
+// update and bits of pure blocks reading changed outputs are set. Blocks later in execution
+// order are updated in the same cycle, earlier ones (feedback) in the next cycle - the same
+// values they would read when updated every cycle.
+//
+// Blocks which are not pure (IO, memory, time, user blocks) and boolean networks run every
+// cycle, only their outputs are watched. Pure block must not change its outputs when updated
+// again with the same inputs (and/or/not, RS, D ...), otherwise it can't be pure.
+//
+void Schematic::PlanChangeDriven(){
+
+	if(!code_options.change_driven) return;
+
+	for(const auto& block: blocks){
+		if(!code_plan.IsEmitted(block->id)) continue;
+
+		auto lib_block = block->lib_block.lock();
+		if(!lib_block || !lib_block->IsPure()) continue;
+
+		code_plan.dirty_index[block->id] = code_plan.dirty_count++;
+	}
+
+	code_report.change_driven_blocks = code_plan.dirty_count;
+}
+
+
+// 'update' is emitted inside block guarded by dirty bit of 'id' (if it has one), watched outputs
+// (PinKeys) mark readers dirty when they change
+void Schematic::WriteChangeDriven(CodeWriter& out, int id, const std::vector<int64_t>& outputs, const std::function<void()>& update){
+	auto dirty = code_plan.dirty_index.find(id);
+
+	// step 1 - outputs read by change-driven blocks
+	std::vector<std::pair<int64_t, std::vector<int>>> watched;
+	for(int64_t key: outputs){
+		std::vector<int> bits;
+		for(const Connection* conn: FindOutputConnections(key >> 32)){
+			if(conn->src_pin != (int)(uint32_t)key) continue;
+
+			auto dst = conn->dst.lock();
+			auto reader = dst ? code_plan.dirty_index.find(dst->id) : code_plan.dirty_index.end();
+			if(reader != code_plan.dirty_index.end() && std::find(bits.begin(), bits.end(), reader->second) == bits.end())
+				bits.push_back(reader->second);
+		}
+		if(!bits.empty()) watched.push_back({key, std::move(bits)});
+	}
+
+	const bool guarded = dirty != code_plan.dirty_index.end();
+	if(!guarded && watched.empty()){
+		update();
+		return;
+	}
+
+	// step 2 - update with values before it
+	if(guarded)
+		out << "        if(plc_dirty[" << dirty->second << "]){\n"
+			   "        plc_dirty[" << dirty->second << "] = false;\n";
+	else
+		out << "        {\n";
+
+	for(int i = 0; i < watched.size(); i++){
+		out << "        const auto plc_old" << i << " = ";
+		WriteSignal(out, watched[i].first >> 32, (uint32_t)watched[i].first);
+		out << ";\n";
+	}
+
+	update();
+
+	// step 3 - readers of changed outputs
+	for(int i = 0; i < watched.size(); i++){
+		out << "        if(";
+		WriteSignal(out, watched[i].first >> 32, (uint32_t)watched[i].first);
+		out << " != plc_old" << i << ") ";
+		for(int bit: watched[i].second)
+			out << "plc_dirty[" << bit << "] = ";
+		out << "true;\n";
+	}
+
+	out << "        }\n";
+}
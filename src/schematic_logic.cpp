@@ -0,0 +1,391 @@
+#include "schematic.hpp"
+#include <vector>
+#include <string>
+#include <map>
+#include <set>
+#include <tuple>
+#include <cstdio>
+#include <algorithm>
+#include <iterator>
+
+
+
+// Boolean networks (CodeOptions::packed_logic)
+//
+// Connected and/or/not/RS/D blocks are not emitted as objects. Every output of such block is
+// one bit of 'uint64_t logic_N[]' array and blocks of the same kind and depth share one word,
+// so up to 64 blocks are updated by single bitwise expression:
+//
+//   and: Q = A & B          or: Q = A | B          not: Q = ~A
+//   RS:  Q = (Q | S) & ~R   D:  Q changes to D when clk differs from previous clk
+//
+// nQ outputs are not stored, readers take inverted Q. Network is evaluated in place of its first
+// block, so a block joins network only if result stays the same as with original execution
+// order: every input coming from outside must be computed before the network and every block
+// reading network output from outside must not expect the value of previous cycle.
+// Connections inside network against execution order read the value of previous cycle.
+//
+namespace {
+
+std::string Hex(uint64_t value){
+	char buf[32];
+	std::snprintf(buf, sizeof(buf), "0x%llxULL", (unsigned long long)value);
+	return buf;
+}
+
+constexpr int MIN_NETWORK_BLOCKS = 2; // single block gains nothing from packing
+
+}
+
+
+
+void Schematic::PlanLogicNetworks(){
+
+	if(!code_options.packed_logic) return;
+
+	using LogicKind = CodePlan::LogicKind;
+
+	// must match update() of the std blocks
+	static const std::unordered_map<std::string, LogicKind> kinds = {
+		{"\\STD\\boolean\\and",  LogicKind::AND},
+		{"\\STD\\boolean\\or",   LogicKind::OR},
+		{"\\STD\\boolean\\not",  LogicKind::NOT},
+		{"\\STD\\register\\RS",  LogicKind::RS},
+		{"\\STD\\register\\D",   LogicKind::D},
+	};
+
+	auto& order = code_plan.order;
+
+	// step 1 - position of every block in execution order
+	for(const auto& block: blocks)
+		order.emplace(block->id, (int)order.size());
+
+	// step 2 - assign blocks to networks in execution order
+	std::unordered_map<int, LogicKind> kind_of;
+	std::unordered_map<int, int> network_of;
+	std::vector<std::vector<int>> members; // in execution order
+	std::vector<int> first;                // execution position of network
+
+	// block can be evaluated by network starting at 'start', 'inside' tells which blocks belong to it
+	auto Fits = [&](int id, int start, const auto& inside){
+		const int pos = order[id];
+
+		auto links = links_index.find(id);
+		if(links == links_index.end()) return true;
+
+		// inputs from outside are ready before network, or were read from previous cycle anyway
+		for(const Connection* conn: links->second.inputs){
+			auto src = conn ? conn->src.lock() : nullptr;
+			if(!src || code_plan.Constant(src->id, conn->src_pin) || inside(src->id)) continue;
+			if(order[src->id] >= start && order[src->id] < pos) return false;
+		}
+
+		// readers from outside run after network, or read previous cycle before network
+		for(const Connection* conn: links->second.outputs){
+			auto dst = conn->dst.lock();
+			if(!dst || code_plan.IsRemoved(dst->id) || inside(dst->id)) continue;
+			if(order[dst->id] >= start && order[dst->id] < pos) return false;
+		}
+		return true;
+	};
+
+	for(const auto& block: blocks){
+		if(code_plan.IsRemoved(block->id)) continue;
+
+		auto lib_block = block->lib_block.lock();
+		if(!lib_block || !lib_block->IsPure()) continue;
+
+		auto kind = kinds.find(lib_block->FullName());
+		if(kind == kinds.end()) continue;
+		kind_of[block->id] = kind->second;
+
+		// networks of sources in the same task, the earliest one first
+		std::vector<int> sources;
+		auto links = links_index.find(block->id);
+		if(links != links_index.end()){
+			for(const Connection* conn: links->second.inputs){
+				auto src = conn ? conn->src.lock() : nullptr;
+				auto src_network = src && TaskOf(*src) == TaskOf(*block) ? network_of.find(src->id) : network_of.end();
+				if(src_network != network_of.end() && std::find(sources.begin(), sources.end(), src_network->second) == sources.end())
+					sources.push_back(src_network->second);
+			}
+		}
+		std::sort(sources.begin(), sources.end(), [&](int a, int b){ return first[a] < first[b]; });
+
+		// try to join all source networks together, then each one alone
+		int network = -1;
+		if(!sources.empty()){
+			const int start = first[sources.front()];
+			auto inside = [&](int id){
+				auto n = network_of.find(id);
+				return id == block->id || (n != network_of.end() && std::find(sources.begin(), sources.end(), n->second) != sources.end());
+			};
+
+			// members of the earliest network already fit, its start does not change
+			bool fits = Fits(block->id, start, inside);
+			for(int i = 1; i < sources.size() && fits; i++)
+				for(int id: members[sources[i]])
+					if(!(fits = Fits(id, start, inside))) break;
+
+			if(fits){
+				network = sources.front();
+				for(int i = 1; i < sources.size(); i++){
+					std::vector<int> merged;
+					std::merge(members[network].begin(), members[network].end(), members[sources[i]].begin(), members[sources[i]].end(),
+						std::back_inserter(merged), [&](int a, int b){ return order[a] < order[b]; });
+					for(int id: members[sources[i]]) network_of[id] = network;
+					members[network] = std::move(merged);
+					members[sources[i]].clear();
+				}
+			}
+		}
+
+		for(int i = 0; i < sources.size() && network < 0; i++){
+			const int candidate = sources[i];
+			auto inside = [&](int id){
+				auto n = network_of.find(id);
+				return id == block->id || (n != network_of.end() && n->second == candidate);
+			};
+			if(Fits(block->id, first[candidate], inside)) network = candidate;
+		}
+
+		if(network < 0){
+			network = members.size();
+			members.emplace_back();
+			first.push_back(order[block->id]);
+		}
+
+		network_of[block->id] = network;
+		members[network].push_back(block->id);
+	}
+
+	// step 3 - split every network into chunks by depth and kind
+	for(const auto& ids: members){
+		if(ids.size() < MIN_NETWORK_BLOCKS) continue;
+
+		const int index = code_plan.networks.size();
+		for(int id: ids)
+			code_plan.logic_blocks[id] = index;
+
+		// depth counts only connections in execution order, others read previous cycle
+		std::unordered_map<int, int> depth;
+		std::map<std::pair<int, LogicKind>, std::vector<int>> groups;
+		for(int id: ids){
+			int d = 0;
+			for(int pin = 0; pin < (kind_of[id] == LogicKind::NOT ? 1 : 2); pin++){
+				const Connection* conn = FindInputConnection(id, pin);
+				auto src = conn ? conn->src.lock() : nullptr;
+				if(!src || code_plan.logic_blocks.count(src->id) == 0 || code_plan.logic_blocks[src->id] != index) continue;
+				if(order[src->id] < order[id]) d = std::max(d, depth[src->id] + 1);
+			}
+			depth[id] = d;
+			groups[{d, kind_of[id]}].push_back(id);
+		}
+
+		CodePlan::LogicNetwork network;
+		network.first_block = ids.front();
+
+		for(const auto& [key, group]: groups){
+			for(size_t i = 0; i < group.size(); i += 64){
+				CodePlan::LogicChunk chunk;
+				chunk.kind = key.second;
+				chunk.word = network.words++;
+				chunk.blocks.assign(group.begin() + i, group.begin() + std::min(group.size(), i + 64));
+
+				for(int bit = 0; bit < chunk.blocks.size(); bit++){
+					const int id = chunk.blocks[bit];
+					code_plan.logic_bits[CodePlan::PinKey(id, 0)] = {index, chunk.word, bit, false};
+					if(chunk.kind != LogicKind::NOT)
+						code_plan.logic_bits[CodePlan::PinKey(id, 1)] = {index, chunk.word, bit, true};
+				}
+				network.chunks.push_back(std::move(chunk));
+			}
+		}
+
+		for(auto& chunk: network.chunks)
+			if(chunk.kind == LogicKind::D) chunk.state_word = network.words++;
+
+		// step 4 - outputs read by blocks outside of network
+		for(int id: ids){
+			std::unordered_set<int> pins;
+			for(const Connection* conn: FindOutputConnections(id)){
+				auto dst = conn->dst.lock();
+				if(!dst || code_plan.IsRemoved(dst->id)) continue;
+
+				auto dst_network = code_plan.logic_blocks.find(dst->id);
+				if(dst_network != code_plan.logic_blocks.end() && dst_network->second == index) continue;
+				if(pins.insert(conn->src_pin).second)
+					network.outputs.push_back(CodePlan::PinKey(id, conn->src_pin));
+			}
+		}
+
+		code_plan.networks.push_back(std::move(network));
+		code_report.packed_blocks += ids.size();
+	}
+
+	code_report.logic_networks = code_plan.networks.size();
+}
+
+
+// value of block output inside main()
+void Schematic::WriteSignal(CodeWriter& out, int id, int pin){
+	if(const bool* value = code_plan.Constant(id, pin))
+		out << (*value ? "plc_const_true" : "plc_const_false");
+	else if(code_options.signal_table)
+		out << "signals.b" << id << "_o" << pin;
+	else if(const CodePlan::LogicBit* bit = code_plan.Bit(id, pin))
+		out << "logic_" << bit->network << "_b" << id << "_o" << pin;
+	else
+		out << "block_" << id << ".output" << pin;
+}
+
+
+void Schematic::WriteLogicDeclarations(CodeWriter& out){
+	if(code_plan.networks.empty()) return;
+
+	out <<
+	"\n\n"
+	"// 	boolean networks\n"
+	"\n\n";
+
+	for(int n = 0; n < code_plan.networks.size(); n++){
+		const auto& network = code_plan.networks[n];
+
+		// bit map of every word, outputs stay readable for monitoring
+		for(const auto& chunk: network.chunks){
+			out << "    // logic_" << n << '[' << chunk.word << "] " << chunk.KindName() << ':';
+			for(int id: chunk.blocks) out << ' ' << id;
+			out << '\n';
+		}
+		out << "    uint64_t logic_" << n << '[' << network.words << "] = {};\n";
+
+		// signal table has its own slots for outputs read outside
+		if(!code_options.signal_table)
+			for(int64_t key: network.outputs)
+				out << "    bool logic_" << n << "_b" << (int)(key >> 32) << "_o" << (int)(uint32_t)key << " = false;\n";
+	}
+}
+
+
+void Schematic::WriteLogicOutputs(CodeWriter& out, int network, const char* indent){
+	for(int64_t key: code_plan.networks[network].outputs){
+		const int id = key >> 32;
+		const int pin = (uint32_t)key;
+		const CodePlan::LogicBit* bit = code_plan.Bit(id, pin);
+		if(!bit) continue;
+
+		out << indent;
+		WriteSignal(out, id, pin);
+		out << " = (" << (bit->inverted ? "~" : "") << "logic_" << network << '[' << bit->word << "] >> " << bit->bit << ") & 1;\n";
+	}
+}
+
+
+void Schematic::WriteLogicUpdate(CodeWriter& out, int network){
+	const auto& net = code_plan.networks[network];
+	const std::string words = "logic_" + std::to_string(network);
+
+	// input bits from the same source word with the same shift are moved together
+	struct Gather {
+		std::map<std::tuple<int, bool, bool, int>, uint64_t> groups; // (word, inverted, previous cycle, shift) -> mask
+		std::vector<std::pair<int64_t, int>> external;               // (PinKey, bit)
+		uint64_t constant = 0;
+	};
+
+	// step 1 - where every input bit comes from
+	std::vector<std::vector<Gather>> gathers(net.chunks.size());
+	std::set<int> previous;
+
+	for(int c = 0; c < net.chunks.size(); c++){
+		const auto& chunk = net.chunks[c];
+		gathers[c].resize(chunk.InputCount());
+
+		for(int bit = 0; bit < chunk.blocks.size(); bit++){
+			const int id = chunk.blocks[bit];
+
+			for(int pin = 0; pin < gathers[c].size(); pin++){
+				Gather& g = gathers[c][pin];
+				const Connection* conn = FindInputConnection(id, pin);
+				auto src = conn ? conn->src.lock() : nullptr;
+				if(!src) continue; // unconnected input reads 'false'
+
+				const bool* value = code_plan.Constant(src->id, conn->src_pin);
+				const CodePlan::LogicBit* src_bit = code_plan.Bit(src->id, conn->src_pin);
+
+				if(value){
+					if(*value) g.constant |= 1ULL << bit;
+				}else if(src_bit && src_bit->network == network){
+					const bool old = code_plan.order[src->id] >= code_plan.order[id];
+					if(old) previous.insert(src_bit->word);
+					g.groups[{src_bit->word, src_bit->inverted, old, bit - src_bit->bit}] |= 1ULL << bit;
+				}else{
+					g.external.push_back({CodePlan::PinKey(src->id, conn->src_pin), bit});
+				}
+			}
+		}
+	}
+
+	// step 2 - evaluate chunks in depth order
+	out << "        { // boolean network " << network << '\n';
+
+	for(int word: previous)
+		out << "            const uint64_t prev_" << word << " = " << words << '[' << word << "];\n";
+
+	for(int c = 0; c < net.chunks.size(); c++){
+		const auto& chunk = net.chunks[c];
+		const uint64_t mask = chunk.blocks.size() == 64 ? ~0ULL : (1ULL << chunk.blocks.size()) - 1;
+
+		out << "            {\n";
+		for(int pin = 0; pin < gathers[c].size(); pin++){
+			const Gather& g = gathers[c][pin];
+			const char* separator = "";
+			out << "                const uint64_t i" << pin << " = ";
+
+			for(const auto& [key, bits]: g.groups){
+				const auto& [word, inverted, old, shift] = key;
+				out << separator << "((" << (inverted ? "~" : "");
+				if(old) out << "prev_" << word;
+				else out << words << '[' << word << ']';
+
+				if(shift > 0) out << " << " << shift;
+				else if(shift < 0) out << " >> " << -shift;
+				out << ") & " << Hex(bits) << ')';
+				separator = " | ";
+			}
+			for(const auto& [key, bit]: g.external){
+				out << separator << "((uint64_t)";
+				WriteSignal(out, key >> 32, (uint32_t)key);
+				out << " << " << bit << ')';
+				separator = " | ";
+			}
+			if(g.constant){
+				out << separator << Hex(g.constant);
+				separator = " | ";
+			}
+			if(!*separator) out << '0';
+			out << ";\n";
+		}
+
+		const std::string q = words + '[' + std::to_string(chunk.word) + ']';
+		out << "                // " << chunk.KindName() << '\n';
+
+		using LogicKind = CodePlan::LogicKind;
+		switch(chunk.kind){
+		case LogicKind::AND: out << "                " << q << " = i0 & i1;\n"; break;
+		case LogicKind::OR:  out << "                " << q << " = i0 | i1;\n"; break;
+		case LogicKind::NOT: out << "                " << q << " = ~i0 & " << Hex(mask) << ";\n"; break;
+		case LogicKind::RS:  out << "                " << q << " = (" << q << " | i0) & ~i1;\n"; break;
+		case LogicKind::D:{
+			const std::string clk = words + '[' + std::to_string(chunk.state_word) + ']';
+			out << "                const uint64_t edge = i1 ^ " << clk << ";\n"
+			       "                " << q << " = (" << q << " & ~edge) | (i0 & edge);\n"
+			       "                " << clk << " = i1;\n";
+			break;
+		}
+		}
+		out << "            }\n";
+	}
+
+	WriteLogicOutputs(out, network, "            ");
+	out << "        }\n";
+}
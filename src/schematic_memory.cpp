@@ -0,0 +1,209 @@
+#include "schematic.hpp"
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <tuple>
+#include <cstdio>
+#include <cstdint>
+
+
+
+// Memory of memory.library blocks
+//
+// Every value type (bool, int64_t, double) has its own address space. Addresses used by the
+// schematic are known when code is generated, so memory is one array per type:
+//
+//   dense addresses  - array indexed by 'address - lowest address'
+//   sparse addresses - array indexed by perfect hash of address, keys table checks the hit
+//
+// Last element of every array is a scratch slot for addresses not used by schematic. Memory
+// blocks resolve their slot once in init() (or at compile time with constant parameters),
+// so every access in cycle is a single indexed load/store.
+//
+namespace {
+
+enum MemoryType { MEMORY_BOOL, MEMORY_INT, MEMORY_REAL, MEMORY_TYPES };
+
+struct MemoryBlock { MemoryType type; bool write; };
+
+// must match the std memory.library blocks, address is parameter 0
+const std::unordered_map<std::string, MemoryBlock>& MemoryBlocks(){
+	static const std::unordered_map<std::string, MemoryBlock> memory_blocks = {
+		{"\\STD\\memory\\mem_read",        {MEMORY_BOOL, false}},
+		{"\\STD\\memory\\mem_write",       {MEMORY_BOOL, true}},
+		{"\\STD\\memory\\mem_read_int",    {MEMORY_INT,  false}},
+		{"\\STD\\memory\\mem_write_int",   {MEMORY_INT,  true}},
+		{"\\STD\\memory\\mem_read_real",   {MEMORY_REAL, false}},
+		{"\\STD\\memory\\mem_write_real",  {MEMORY_REAL, true}},
+	};
+	return memory_blocks;
+}
+
+constexpr const char* TYPE_NAMES[MEMORY_TYPES] = {"bool", "int64_t", "double"};
+constexpr const char* ARRAY_NAMES[MEMORY_TYPES] = {"bool_values", "int_values", "real_values"};
+constexpr const char* SLOT_NAMES[MEMORY_TYPES] = {"BoolSlot", "IntSlot", "RealSlot"};
+
+constexpr int MAX_DENSE_GAP = 64;         // dense array may have this many unused slots plus one per address
+constexpr int PERFECT_HASH_ATTEMPTS = 1000;
+
+int64_t AddressParameter(const Schematic::Block& block){
+	if(block.parameters.empty() || !std::holds_alternative<int64_t>(block.parameters[0])) return 0; // default value of parameter
+	return std::get<int64_t>(block.parameters[0]);
+}
+
+uint32_t HashSlot(int64_t address, uint64_t multiplier, int bits){
+	return bits == 0 ? 0 : (uint32_t)(((uint64_t)address * multiplier) >> (64 - bits));
+}
+
+// INT64_MIN can't be written as negated literal
+std::string Literal(int64_t value){
+	if(value == INT64_MIN) return "(-9223372036854775807LL - 1)";
+	return std::to_string(value) + "LL";
+}
+
+std::string Hex(uint64_t value){
+	char buf[32];
+	std::snprintf(buf, sizeof(buf), "0x%llxULL", (unsigned long long)value);
+	return buf;
+}
+
+}
+
+
+
+void Schematic::PlanMemory(){
+
+	const auto& memory_blocks = MemoryBlocks();
+
+	// step 1 - addresses read and written by emitted blocks
+	std::vector<std::unordered_set<int64_t>> written(MEMORY_TYPES);
+	std::vector<std::tuple<int, MemoryType, int64_t>> reads;
+
+	for(const auto& block: blocks){
+		if(code_plan.IsRemoved(block->id)) continue;
+		auto lib_block = block->lib_block.lock();
+		if(!lib_block) continue;
+
+		auto kind = memory_blocks.find(lib_block->FullName());
+		if(kind == memory_blocks.end()) continue;
+
+		const int64_t address = AddressParameter(*block);
+		auto& table = code_plan.memory[kind->second.type];
+		if(std::find(table.addresses.begin(), table.addresses.end(), address) == table.addresses.end())
+			table.addresses.push_back(address);
+
+		if(kind->second.write)
+			written[kind->second.type].insert(address);
+		else
+			reads.push_back({block->id, kind->second.type, address});
+	}
+
+	// step 2 - reads of addresses no block writes, they always return zero
+	for(const auto& [id, type, address]: reads)
+		if(!written[type].count(address))
+			code_report.unwritten_memory_reads.push_back(id);
+
+	// step 3 - layout of every array
+	for(auto& table: code_plan.memory){
+		if(table.addresses.empty()) continue;
+		code_plan.uses_memory = true;
+		code_report.memory_addresses += table.addresses.size();
+
+		std::sort(table.addresses.begin(), table.addresses.end());
+		const int64_t low = table.addresses.front();
+		const uint64_t span = (uint64_t)table.addresses.back() - (uint64_t)low + 1;
+
+		if(span <= table.addresses.size() * 2 + MAX_DENSE_GAP){
+			table.layout = CodePlan::MemoryTable::Layout::DENSE;
+			table.size = span;
+			continue;
+		}
+
+		// sparse - multiplicative hash without collisions, table grows when none is found
+		uint64_t seed = 0x9e3779b97f4a7c15ULL;
+		int bits = 0;
+		while((1ULL << bits) < table.addresses.size()) bits++;
+
+		for(int max_bits = bits + 4; bits <= max_bits && !table.multiplier; bits++){
+			std::vector<bool> used(1ULL << bits);
+			for(int attempt = 0; attempt < PERFECT_HASH_ATTEMPTS && !table.multiplier; attempt++){
+				seed += 0x9e3779b97f4a7c15ULL; // splitmix64
+				uint64_t m = seed;
+				m = (m ^ (m >> 30)) * 0xbf58476d1ce4e5b9ULL;
+				m = (m ^ (m >> 27)) * 0x94d049bb133111ebULL;
+				m = (m ^ (m >> 31)) | 1;
+
+				std::fill(used.begin(), used.end(), false);
+				bool collision = false;
+				for(int64_t address: table.addresses){
+					uint32_t h = HashSlot(address, m, bits);
+					if(used[h]){ collision = true; break; }
+					used[h] = true;
+				}
+				if(!collision){
+					table.layout = CodePlan::MemoryTable::Layout::HASH;
+					table.multiplier = m;
+					table.bits = bits;
+					table.size = 1 << bits;
+				}
+			}
+		}
+
+		// no perfect hash (practically never happens) - keys are searched one by one
+		if(!table.multiplier){
+			table.layout = CodePlan::MemoryTable::Layout::SEARCH;
+			table.size = table.addresses.size();
+		}
+	}
+}
+
+
+// arrays of memory blocks and address -> slot functions, part of process image
+void Schematic::WriteMemory(CodeWriter& out){
+	if(!code_plan.uses_memory) return;
+
+	out <<
+	"\n\n"
+	"// 	memory\n"
+	"\n\n"
+	"struct PLC_Memory {\n";
+
+	for(int type = 0; type < MEMORY_TYPES; type++){
+		const auto& table = code_plan.memory[type];
+		if(table.addresses.empty()) continue;
+
+		const int64_t low = table.addresses.front();
+		out << "    " << TYPE_NAMES[type] << ' ' << ARRAY_NAMES[type] << '[' << table.size + 1 << "] = {}; // "
+			<< table.addresses.size() << " addresses, last slot - unused addresses\n";
+
+		if(table.layout == CodePlan::MemoryTable::Layout::HASH){
+			std::vector<int64_t> keys(table.size, table.addresses.front()); // slot of first address never matches other key
+			for(int64_t address: table.addresses)
+				keys[HashSlot(address, table.multiplier, table.bits)] = address;
+
+			out << "    static constexpr int64_t " << ARRAY_NAMES[type] << "_keys[" << table.size << "] = {";
+			for(int i = 0; i < keys.size(); i++) out << (i ? ", " : "") << Literal(keys[i]);
+			out << "};\n"
+				<< "    static constexpr int " << SLOT_NAMES[type] << "(int64_t address){\n"
+				<< "        const int h = (int)(((uint64_t)address * " << Hex(table.multiplier) << ") >> " << 64 - table.bits << ");\n"
+				<< "        return " << ARRAY_NAMES[type] << "_keys[h] == address ? h : " << table.size << ";\n"
+				<< "    }\n";
+		}else if(table.layout == CodePlan::MemoryTable::Layout::SEARCH){
+			out << "    static constexpr int64_t " << ARRAY_NAMES[type] << "_keys[" << table.size << "] = {";
+			for(int i = 0; i < table.addresses.size(); i++) out << (i ? ", " : "") << Literal(table.addresses[i]);
+			out << "};\n"
+				<< "    static constexpr int " << SLOT_NAMES[type] << "(int64_t address){\n"
+				<< "        for(int i = 0; i < " << table.size << "; i++) if(" << ARRAY_NAMES[type] << "_keys[i] == address) return i;\n"
+				<< "        return " << table.size << ";\n"
+				<< "    }\n";
+		}else{
+			out << "    static constexpr int " << SLOT_NAMES[type] << "(int64_t address){ return address >= " << Literal(low)
+				<< " && address <= " << Literal(table.addresses.back()) << " ? (int)(address - " << Literal(low) << ") : " << table.size << "; }\n";
+		}
+	}
+
+	out <<
+	"};\n"
+	"\n"
+	"inline PLC_Memory plc_memory;\n";
+}
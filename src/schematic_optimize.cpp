@@ -0,0 +1,128 @@
+#include "schematic.hpp"
+#include <vector>
+#include <string>
+
+
+
+// Optimization pass run by BuildToCPP before code is emitted
+//
+// 1) constant folding - pure blocks with behaviour known to code generator are evaluated here
+//    when all their inputs are constant (const_bool, and, or, not ...). their outputs become
+//    constants and inputs connected to them read shared constant instead.
+//
+// 2) dead blocks - only blocks which are not pure (IO, memory, time, user blocks without
+//    "pure" flag) have effect outside of program. pure blocks whose outputs never reach such
+//    block are removed.
+//
+namespace {
+
+using Inputs = std::vector<bool>;
+using Outputs = std::vector<bool>;
+using Evaluator = Outputs(*)(const Inputs& in, const Schematic::Block& block);
+
+bool BoolParameter(const Schematic::Block& block, int i){
+	if(i >= block.parameters.size()) return false;
+	if(!std::holds_alternative<bool>(block.parameters[i])) return false;
+	return std::get<bool>(block.parameters[i]);
+}
+
+// must match update() of the std blocks, unconnected input reads 'false'
+const std::unordered_map<std::string, Evaluator>& ConstantEvaluators(){
+	static const std::unordered_map<std::string, Evaluator> evaluators = {
+		{"\\STD\\const\\const_bool", [](const Inputs&, const Schematic::Block& b) -> Outputs { return {BoolParameter(b, 0)}; }},
+		{"\\STD\\boolean\\and",      [](const Inputs& in, const Schematic::Block&) -> Outputs { bool q = in[0] && in[1]; return {q, !q}; }},
+		{"\\STD\\boolean\\or",       [](const Inputs& in, const Schematic::Block&) -> Outputs { bool q = in[0] || in[1]; return {q, !q}; }},
+		{"\\STD\\boolean\\not",      [](const Inputs& in, const Schematic::Block&) -> Outputs { return {!in[0]}; }},
+	};
+	return evaluators;
+}
+
+}
+
+
+
+void Schematic::OptimizeCode(){
+
+	code_plan = CodePlan();
+	code_report = CodeReport();
+
+	if(!code_options.optimize) return;
+
+	// step 1 - constant folding in execution order
+	std::unordered_set<int> folded;
+	const auto& evaluators = ConstantEvaluators();
+
+	for(const auto& block: blocks){
+		auto lib_block = block->lib_block.lock();
+		if(!lib_block || !lib_block->IsPure()) continue;
+
+		auto evaluator = evaluators.find(lib_block->FullName());
+		if(evaluator == evaluators.end()) continue;
+
+		Inputs in(lib_block->Inputs().size(), false);
+		bool constant = true;
+
+		for(int i = 0; i < in.size() && constant; i++){
+			const Connection* conn = FindInputConnection(block->id, i);
+			auto src = conn ? conn->src.lock() : nullptr;
+			if(!src) continue; // unconnected
+
+			const bool* value = code_plan.Constant(src->id, conn->src_pin);
+			if(value) in[i] = *value;
+			else constant = false;
+		}
+		if(!constant) continue;
+
+		Outputs out = evaluator->second(in, *block);
+		if(out.size() != lib_block->Outputs().size()) continue;
+
+		for(int i = 0; i < out.size(); i++)
+			code_plan.constants[CodePlan::PinKey(block->id, i)] = out[i];
+		folded.insert(block->id);
+	}
+
+	// step 2 - mark blocks reachable (against connections) from blocks with side effects
+	std::unordered_set<int> live;
+	std::unordered_set<int> folded_used;
+	std::vector<int> stack;
+
+	for(const auto& block: blocks){
+		if(folded.count(block->id)) continue;
+
+		auto lib_block = block->lib_block.lock();
+		if(lib_block && lib_block->IsPure()) continue;
+
+		live.insert(block->id);
+		stack.push_back(block->id);
+	}
+
+	while(!stack.empty()){
+		int id = stack.back();
+		stack.pop_back();
+
+		auto links = links_index.find(id);
+		if(links == links_index.end()) continue;
+
+		for(const Connection* conn: links->second.inputs){
+			if(!conn) continue;
+			auto src = conn->src.lock();
+			if(!src) continue;
+
+			if(folded.count(src->id))
+				folded_used.insert(src->id);
+			else if(live.insert(src->id).second)
+				stack.push_back(src->id);
+		}
+	}
+
+	// step 3 - everything else is not emitted
+	for(const auto& block: blocks){
+		if(live.count(block->id)) continue;
+
+		code_plan.removed.insert(block->id);
+		if(folded_used.count(block->id))
+			code_report.folded_blocks.push_back(block->id);
+		else
+			code_report.removed_blocks.push_back(block->id);
+	}
+}
@@ -0,0 +1,277 @@
+#include "schematic.hpp"
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <numeric>
+
+
+
+// Parallel execution (CodeOptions::workers > 1)
+//
+// Every cycle is split into phases. Blocks which are not pure (IO, memory, time, user blocks
+// without "pure" flag) run in serial phases on the main thread, in their original order, so
+// shared state outside of blocks is accessed as before. Pure blocks run in parallel phases:
+// blocks of one phase are split into weakly connected components and components are spread
+// over workers. Worker pool waits for all workers at the end of every parallel phase.
+//
+// Phase of a block is never lower than phase of its sources, so it reads results of the same
+// cycle. For connections against execution order (feedback) phase of the source is never
+// lower than phase of the reader, so reader still gets value of previous cycle.
+//
+// Cost of block is 1, cost of boolean network is number of its words. When expected speedup
+// is low (small program, one large component, too many phases) program stays serial.
+// With multi-rate tasks every task gets its own phases, cost is weighted by task rate.
+//
+namespace {
+
+constexpr int MAX_WORKERS = 64;
+constexpr double BARRIER_COST = 100.0;      // cost of waiting for workers, in block updates
+constexpr double MIN_PARALLEL_SPEEDUP = 1.2;
+
+// disjoint sets of units
+struct Components {
+	std::vector<int> parent;
+
+	explicit Components(int n): parent(n) { std::iota(parent.begin(), parent.end(), 0); }
+
+	int Find(int i){
+		while(parent[i] != i) i = parent[i] = parent[parent[i]];
+		return i;
+	}
+	void Join(int a, int b){ parent[Find(a)] = Find(b); }
+};
+
+}
+
+
+
+const Schematic::CodeReport& Schematic::AnalyzeCode(){
+	OptimizeCode();
+	PlanTasks();
+	PlanMemory();
+	PlanLogicNetworks();
+	PlanChangeDriven();
+	PlanParallel();
+	return code_report;
+}
+
+
+void Schematic::PlanParallel(){
+
+	// dirty bits are shared by all blocks, change-driven program stays on one thread
+	if(code_options.workers < 2 || code_options.change_driven) return;
+	const int workers = std::min(code_options.workers, MAX_WORKERS);
+
+	double total = 0.0;
+	double critical = 0.0;
+	int parallel_phases = 0;
+	std::unordered_map<int, CodeReport::Part> partition;
+
+	// every task is planned alone, its cost counts only in cycles when it is due
+	for(int task: code_plan.task_order){
+		const double rate = 1.0 / tasks[task].period;
+
+		// step 1 - units in execution order: emitted blocks and boolean networks
+		std::vector<int> units;                  // id of block, or of first block of network
+		std::unordered_map<int, int> unit_of;    // block id -> index in units
+		std::vector<std::vector<int>> unit_blocks;
+		std::vector<bool> pure;
+		std::vector<double> cost;
+
+		for(const auto& block: blocks){
+			if(code_plan.IsRemoved(block->id) || TaskOf(*block) != task) continue;
+
+			auto network = code_plan.logic_blocks.find(block->id);
+			if(network != code_plan.logic_blocks.end()){
+				const auto& net = code_plan.networks[network->second];
+				if(net.first_block != block->id) continue;
+
+				unit_blocks.emplace_back();
+				for(const auto& chunk: net.chunks)
+					unit_blocks.back().insert(unit_blocks.back().end(), chunk.blocks.begin(), chunk.blocks.end());
+				pure.push_back(true);
+				cost.push_back(net.words);
+			}else{
+				auto lib_block = block->lib_block.lock();
+				unit_blocks.push_back({block->id});
+				pure.push_back(lib_block && lib_block->IsPure());
+				cost.push_back(1.0);
+			}
+
+			for(int id: unit_blocks.back())
+				unit_of[id] = units.size();
+			units.push_back(block->id);
+		}
+
+		// units connected to unit 'u', before 'u' in execution order
+		// (blocks of other tasks never run at the same time, they are not units here)
+		auto Earlier = [&](int u, auto&& func){
+			for(int id: unit_blocks[u]){
+				auto links = links_index.find(id);
+				if(links == links_index.end()) continue;
+
+				for(const Connection* conn: links->second.inputs){
+					auto src = conn ? conn->src.lock() : nullptr;
+					auto src_unit = src ? unit_of.find(src->id) : unit_of.end();
+					if(src_unit != unit_of.end() && src_unit->second < u) func(src_unit->second);
+				}
+				for(const Connection* conn: links->second.outputs){
+					auto dst = conn->dst.lock();
+					auto dst_unit = dst ? unit_of.find(dst->id) : unit_of.end();
+					if(dst_unit != unit_of.end() && dst_unit->second < u) func(dst_unit->second);
+				}
+			}
+		};
+
+		// step 2 - phase of every unit, even phases are serial, odd are parallel
+		std::vector<int> phase(units.size(), 0);
+		int last_serial = 0;
+
+		for(int u = 0; u < units.size(); u++){
+			int p = 0;
+			Earlier(u, [&](int other){ p = std::max(p, phase[other]); });
+
+			if(!pure[u]){
+				p = std::max(p, last_serial);
+				if(p % 2) p++;
+				last_serial = p;
+			}else if(p % 2 == 0){
+				p++;
+			}
+			phase[u] = p;
+		}
+
+		// step 3 - components inside every parallel phase
+		Components components(units.size());
+		for(int u = 0; u < units.size(); u++){
+			if(phase[u] % 2 == 0) continue;
+			Earlier(u, [&](int other){ if(phase[other] == phase[u]) components.Join(u, other); });
+		}
+
+		std::map<int, std::map<int, std::vector<int>>> phase_components; // phase -> root -> units
+		for(int u = 0; u < units.size(); u++)
+			phase_components[phase[u]][phase[u] % 2 ? components.Find(u) : 0].push_back(u);
+
+		// unit indexes -> block ids used by code generator
+		auto Add = [&](CodePlan::Phase& result){
+			const int p = code_plan.phases.size();
+			for(int w = 0; w < result.parts.size(); w++){
+				for(int& u: result.parts[w]){
+					for(int id: unit_blocks[u])
+						partition[id] = {p, result.parallel ? w : -1};
+					u = units[u];
+				}
+			}
+			code_plan.phases.push_back(std::move(result));
+		};
+
+		// step 4 - spread components over workers, the largest first
+		for(const auto& [p, roots]: phase_components){
+			CodePlan::Phase result;
+			result.parallel = p % 2;
+			result.task = task;
+
+			if(!result.parallel){
+				result.parts.emplace_back();
+				for(int u: roots.at(0)){
+					result.parts[0].push_back(u);
+					total += cost[u] * rate;
+					critical += cost[u] * rate;
+				}
+				Add(result);
+				continue;
+			}
+
+			std::vector<std::pair<double, const std::vector<int>*>> sorted;
+			for(const auto& [root, list]: roots){
+				double c = 0.0;
+				for(int u: list) c += cost[u];
+				sorted.push_back({c, &list});
+				total += c * rate;
+			}
+			std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b){ return a.first > b.first; });
+
+			std::vector<double> load(workers, 0.0);
+			result.parts.resize(workers);
+			for(const auto& [c, list]: sorted){
+				const int w = std::min_element(load.begin(), load.end()) - load.begin();
+				load[w] += c;
+				result.parts[w].insert(result.parts[w].end(), list->begin(), list->end());
+			}
+			for(auto& part: result.parts)
+				std::sort(part.begin(), part.end());
+
+			critical += (*std::max_element(load.begin(), load.end()) + BARRIER_COST) * rate;
+			parallel_phases++;
+			Add(result);
+		}
+	}
+
+	code_report.expected_speedup = critical > 0.0 ? total / critical : 1.0;
+
+	// step 5 - serial program when parallel one would not be faster
+	if(code_report.expected_speedup < MIN_PARALLEL_SPEEDUP){
+		code_plan.phases.clear();
+		return;
+	}
+
+	code_report.workers = workers;
+	code_report.parallel_phases = parallel_phases;
+	code_report.partition = std::move(partition);
+}
+
+
+// update of emitted block, or of whole network in place of its first block
+void Schematic::WriteBlockUpdate(CodeWriter& out, int id){
+	if(code_plan.IsEmitted(id)){
+		auto update = [&](){ out << "        block_" << id << ".update();\n"; };
+		if(!code_options.change_driven){
+			update();
+			return;
+		}
+
+		std::vector<int64_t> outputs;
+		auto block = FindBlock(id);
+		auto lib_block = block ? block->lib_block.lock() : nullptr;
+		for(int pin = 0; lib_block && pin < lib_block->Outputs().size(); pin++)
+			outputs.push_back(CodePlan::PinKey(id, pin));
+		WriteChangeDriven(out, id, outputs, update);
+		return;
+	}
+
+	auto network = code_plan.logic_blocks.find(id);
+	if(network == code_plan.logic_blocks.end() || code_plan.networks[network->second].first_block != id) return;
+
+	if(code_options.change_driven)
+		WriteChangeDriven(out, id, code_plan.networks[network->second].outputs, [&](){ WriteLogicUpdate(out, network->second); });
+	else
+		WriteLogicUpdate(out, network->second);
+}
+
+
+// parts of parallel phases, numbered as PLC_WorkerPool::Run expects
+void Schematic::WriteWorkerParts(CodeWriter& out){
+	out <<
+	"\n\n"
+	"// 	worker parts\n"
+	"\n\n"
+	"    auto plc_part = [&](int part){\n"
+	"        switch(part){\n";
+
+	int part = 0;
+	for(const auto& phase: code_plan.phases){
+		if(!phase.parallel) continue;
+
+		for(const auto& ids: phase.parts){
+			out << "        case " << part++ << ":\n";
+			for(int id: ids) WriteBlockUpdate(out, id);
+			out << "        break;\n";
+		}
+	}
+
+	out <<
+	"        }\n"
+	"    };\n"
+	"    PLC_WorkerPool<" << code_report.workers << "> plc_workers(plc_part);\n";
+}
@@ -0,0 +1,61 @@
+#include "schematic.hpp"
+#include <vector>
+#include <string>
+#include <numeric>
+#include <algorithm>
+
+
+
+// Multi-rate tasks (Schematic::tasks)
+//
+// Generated loop counts base cycles. In every cycle due tasks (cycle % period == offset) run
+// one after another, highest priority first, each one updates its blocks in execution order.
+// Tasks never interrupt each other, so a block reading output of other task always gets value
+// of its last completed run - either from this cycle (task ran before) or from an earlier one.
+//
+// IO image is read before the first task and written after the last one, so a slow task
+// keeps its outputs between runs. Boolean networks and parallel phases never span two tasks.
+//
+std::vector<int> Schematic::TaskOrder() const {
+	std::vector<int> order(tasks.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [this](int a, int b){ return tasks[a].priority > tasks[b].priority; });
+	return order;
+}
+
+
+void Schematic::PlanTasks(){
+
+	code_plan.task_order = TaskOrder();
+	if(!IsMultiTask()) return;
+
+	std::vector<int> block_count(tasks.size(), 0);
+	for(const auto& block: blocks)
+		if(!code_plan.IsRemoved(block->id)) block_count[TaskOf(*block)]++;
+
+	for(int task: code_plan.task_order){
+		const Task& t = tasks[task];
+		code_report.tasks.push_back({t.name, t.period, t.offset, t.priority, block_count[task]});
+	}
+}
+
+
+// task name comes from schematic file, control characters (new line) would end the comment
+static std::string CommentSafe(std::string text){
+	for(char& c: text)
+		if((unsigned char)c < 0x20 || c == 0x7f) c = ' ';
+	return text;
+}
+
+
+// start of task in update loop, returns false when task runs every cycle without condition
+bool Schematic::WriteTaskBegin(CodeWriter& out, int task){
+	if(!IsMultiTask()) return false;
+
+	const Task& t = tasks[task];
+	out << "        // task " << task << " \"" << CommentSafe(t.name) << "\" - period " << t.period << ", offset " << t.offset << ", priority " << t.priority << "\n";
+	if(t.period == 1) return false;
+
+	out << "        if(plc_cycle % " << t.period << " == " << t.offset << "){\n";
+	return true;
+}
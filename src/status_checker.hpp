@@ -40,19 +40,17 @@ private:
             return AppStatus::_DISCONNECTED;
         }
 
-        plc_client->CheckAppStatus();
-
-        PLCclient::AppStatusResponse response;
-        auto start = std::chrono::high_resolution_clock::now();
-        while(!plc_client->GetIfAppStatusResponse(&response)){
-            auto now = std::chrono::high_resolution_clock::now();
+        auto reply = plc_client->CheckAppStatus();
+        if(reply.wait_for(response_timeout) != std::future_status::ready){
+            return AppStatus::_TIMEOUT;
+        }
 
-            if(now > start + response_timeout){
-                return AppStatus::_TIMEOUT;
-            }
+        std::optional<PLCclient::AppStatusResponse> response = reply.get();
+        if(!response){
+            return AppStatus::_DISCONNECTED;
         }
         
-        switch(response.status){
+        switch(response->status){
         case PLCclient::AppStatusResponse::Status::_UNNOWN : return AppStatus::_UNNOWN;
         case PLCclient::AppStatusResponse::Status::_RUNNING : return AppStatus::_RUNNING;
         case PLCclient::AppStatusResponse::Status::_STOPPED : return AppStatus::_STOPPED;
@@ -7,11 +7,23 @@
 #include <boost/asio.hpp>
 #include <iostream>
 #include <queue>
+#include <deque>
+#include <vector>
+#include <array>
 #include <boost/json.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
 #include <chrono>
 #include <functional>
+#include <atomic>
+#include <future>
+#include <optional>
+#include <map>
+#include <algorithm>
 #include "thread.hpp"
 #include "debug_console.hpp"
+#include "json_frame_reader.hpp"
 
 
 
@@ -23,15 +35,24 @@ public:
 
 
 private:
-    std::recursive_mutex tcp_mutex;
+    // io_context runs all the time on client thread, every socket operation and handler runs on
+    // strand, so other threads only post work and never wait for network
     boost::asio::io_context io_context;
+    boost::asio::strand<boost::asio::io_context::executor_type> strand;
+    boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work_guard;
     boost::asio::ip::tcp::socket socket;
     boost::asio::ip::tcp::endpoint endpoint;
 
-    static constexpr size_t read_buffer_size = 1024;
-    uint8_t read_buffer[read_buffer_size];
+    static constexpr size_t read_buffer_size = 64 * 1024;
+    std::vector<uint8_t> read_buffer = std::vector<uint8_t>(read_buffer_size);
 
-    Status status;
+    // only one write is in progress, so frames (e.g. file chunks) are never interleaved
+    std::deque<std::shared_ptr<std::vector<uint8_t>>> write_queue;
+
+    // handlers of previous connection are ignored after Connect/Disconnect
+    uint64_t connection_id = 0;
+
+    std::atomic<Status> status;
 
 
 public:
@@ -43,7 +64,8 @@ public:
         IPaddress() { addr[0] = 0;addr[1] = 0;addr[2] = 0;addr[3] = 0; port = 0; }
     };
 
-    TCPclient(): status(Status::DISCONNECTED), io_context(), socket(io_context) {
+    TCPclient(): io_context(), strand(boost::asio::make_strand(io_context)), work_guard(boost::asio::make_work_guard(io_context)), 
+                 socket(io_context), status(Status::DISCONNECTED) {
         Start(); // start thread routine 
     }
 
@@ -53,8 +75,15 @@ public:
     }
 
 
+    // io_context runs until client is stopped
+    void Stop(){
+        Thread::Stop();
+        work_guard.reset();
+        io_context.stop();
+    }
+
+
     Status GetStatus(){
-        std::scoped_lock lock(tcp_mutex);
         return status;
     }
 
@@ -72,121 +101,145 @@ public:
 
 
     bool SetIp( IPaddress ip ){
-        std::scoped_lock lock(tcp_mutex);
+        if(status != Status::DISCONNECTED) return false;
 
-        bool result;
-        if(status == Status::DISCONNECTED){
+        boost::asio::post(strand, [this, ip](){
             boost::asio::ip::address_v4::bytes_type addr = { ip.addr[0], ip.addr[1], ip.addr[2], ip.addr[3] };          
             endpoint.address(boost::asio::ip::make_address_v4(addr));
             endpoint.port(ip.port);
-            return true;
-        }else{
-            return false;
-        }
+        });
+        return true;
     }
 
 
     void Connect(){
-        std::scoped_lock lock(tcp_mutex);
+        status = Status::CONNECTING;
 
-        if(status != Status::DISCONNECTED){
+        boost::asio::post(strand, [this](){
             socket.close();
-        }
-
-        status = Status::CONNECTING;
+            write_queue.clear();
+            const uint64_t id = ++connection_id;
 
-        onConnecting();
-        socket.async_connect(
-            endpoint, 
-            [this](const boost::system::error_code& error)
-            {
-                if(error){
-                    status = Status::DISCONNECTED;
-                    socket.close();
-                }else{
-                    status = Status::CONNECTED;
-                }
+            onConnecting();
+            socket.async_connect(
+                endpoint, 
+                boost::asio::bind_executor(strand, [this, id](const boost::system::error_code& error)
+                {
+                    if(id != connection_id) return;
+
+                    if(error){
+                        status = Status::DISCONNECTED;
+                        socket.close();
+                    }else{
+                        status = Status::CONNECTED;
+                        // no Nagle delay for short request/response messages
+                        boost::system::error_code ignored;
+                        socket.set_option(boost::asio::ip::tcp::no_delay(true), ignored);
+                        Read();
+                    }
 
-                Read();
-                onConnected(error);
-            } 
+                    onConnected(error);
+                })
             );
-
+        });
     }
 
 
     bool Disconnect(){
-        std::scoped_lock lock(tcp_mutex);
-        
-        boost::system::error_code err;
-        socket.close();
-        if(status != Status::DISCONNECTED) 
-            onDisconnected(err);
-        status = Status::DISCONNECTED;
-
-        if(err) return false;
-        else return true;
+        boost::asio::post(strand, [this](){
+            ++connection_id;
+            socket.close();
+            write_queue.clear();
+            if(status != Status::DISCONNECTED) 
+                onDisconnected(boost::system::error_code());
+            status = Status::DISCONNECTED;
+        });
+        return true;
     }
 
 
 protected:
 
 
+    // runs on strand
     void Read(){
-
-        std::scoped_lock lock(tcp_mutex);
+        const uint64_t id = connection_id;
 
         socket.async_receive(
-            boost::asio::buffer(read_buffer, read_buffer_size), 
-            [this](const boost::system::error_code& error, size_t bytes_received)
+            boost::asio::buffer(read_buffer.data(), read_buffer_size), 
+            boost::asio::bind_executor(strand, [this, id](const boost::system::error_code& error, size_t bytes_received)
             {
-                if(error){
-                    socket.close();
-                    if(status != Status::DISCONNECTED) 
-                        onDisconnected(error);
+                if(id != connection_id) return;
 
-                    status = Status::DISCONNECTED;
-                }else{
-                    status = Status::CONNECTED;
+                if(error){
+                    ConnectionLost(error);
                 }
 
-                onRead(error, bytes_received, read_buffer);
+                onRead(error, bytes_received, read_buffer.data());
                 if(!error) Read();
-            }
+            })
         );
     }
 
 
     void Write(const uint8_t* const data, size_t len){
+        // copy data to memory
+        Write(std::vector<uint8_t>(data, data + len));
+    }
 
-        std::scoped_lock lock(tcp_mutex);
+    // can be called from any thread, data is sent on strand
+    void Write(std::vector<uint8_t> data){
 
-        // copy data to memory
 		// shared pointer is necessary because data must be valid until handler is called
-		std::shared_ptr<uint8_t[]> mem(new uint8_t[len]);
-		memcpy(mem.get(), data, len);
-        
-        socket.async_write_some(
-            boost::asio::buffer(mem.get(), len),
-			[this, mem](const boost::system::error_code& error, std::size_t bytes_transferred)
+        auto mem = std::make_shared<std::vector<uint8_t>>(std::move(data));
+
+        boost::asio::post(strand, [this, mem](){
+            write_queue.push_back(mem);
+            if(write_queue.size() == 1) WriteNext();
+        });
+    }
+
+
+private:
+
+    void ConnectionLost(const boost::system::error_code& error){
+        ++connection_id;
+        socket.close();
+        write_queue.clear();
+        if(status != Status::DISCONNECTED) 
+            onDisconnected(error);
+
+        status = Status::DISCONNECTED;
+    }
+
+    // async_write sends whole buffer (async_write_some may send only part of it)
+    void WriteNext(){
+        std::shared_ptr<std::vector<uint8_t>> mem = write_queue.front();
+        const uint64_t id = connection_id;
+
+        boost::asio::async_write(
+            socket,
+            boost::asio::buffer(*mem),
+            boost::asio::bind_executor(strand, [this, mem, id](const boost::system::error_code& error, std::size_t bytes_transferred)
 			{ 
-                if(error){
-                    socket.close();
-                    if(status != Status::DISCONNECTED) 
-                        onDisconnected(error);
+                if(id != connection_id) return;
 
-                    status = Status::DISCONNECTED;
+                if(error){
+                    ConnectionLost(error);
                 }else{
-                    status = Status::CONNECTED;
+                    write_queue.pop_front();
                 }
 
                 onWrite(error, bytes_transferred); 
-            }
+                if(!write_queue.empty()) WriteNext();
+            })
         );
-
     }
 
 
+protected:
+
+
     virtual void onConnecting() = 0;
 
 
@@ -201,27 +254,11 @@ protected:
 	// this function is called when data is succesfuly(or not) sent to client
 	virtual void onWrite(const boost::system::error_code& error, std::size_t bytes_transferred) = 0;
 
-    virtual void onLoop() = 0;
-
 
     void threadJob() override{
 
-
         try{
-            while(IsRun()){
-
-                auto step = std::chrono::milliseconds(10);
-                auto now = std::chrono::high_resolution_clock::now();
-
-                {
-                    std::scoped_lock lock(tcp_mutex);
-                    onLoop();
-                    io_context.run_until(now + step);
-                }
-
-                std::this_thread::sleep_until(now + step);
-
-            }
+            io_context.run(); // returns after Stop()
         }catch (std::exception& e) {
 			std::cout << "Caught error in context.run(): \n\t" << e.what() << "\n\t"
 					  << "TCP Client stops working !!!\n\n";
@@ -244,7 +281,9 @@ public:
         CONNECTED,
         DISCONNECTED,
         CONNECTION_FAILED,
-        CONNECTION_LOST
+        CONNECTION_LOST,
+        INVALID_MESSAGE,
+        MESSAGE_TOO_LARGE
     };
 
     struct Event{
@@ -266,6 +305,8 @@ public:
                 case EventType::DISCONNECTED:      str = "Disconnected";      break;
                 case EventType::CONNECTION_FAILED: str = "Connection Failed"; break;
                 case EventType::CONNECTION_LOST:   str = "Connection Lost";   break;
+                case EventType::INVALID_MESSAGE:   str = "Received invalid message"; break;
+                case EventType::MESSAGE_TOO_LARGE: str = "Received message exceeds max frame size, dropped"; break;
                 default: str = "Unnown event";
             }
 
@@ -285,6 +326,8 @@ public:
                 case EventType::DISCONNECTED:      return DebugLogger::Priority::_WARNING;
                 case EventType::CONNECTION_FAILED: return DebugLogger::Priority::_ERROR;
                 case EventType::CONNECTION_LOST:   return DebugLogger::Priority::_ERROR;
+                case EventType::INVALID_MESSAGE:   return DebugLogger::Priority::_WARNING;
+                case EventType::MESSAGE_TOO_LARGE: return DebugLogger::Priority::_WARNING;
                 default: return DebugLogger::Priority::_INFO;
             }
         }
@@ -324,11 +367,15 @@ public:
     }
 
 
+    // longer received lines are dropped
+    void SetMaxFrameSize(size_t size){
+        frame_reader.SetMaxFrameSize(size);
+    }
+
+
+    // some message was received in last 'response_check_delay'
     bool IsResponding(){
-        event_queue_mutex.lock();
-        bool is_resp = is_responding;
-        event_queue_mutex.unlock();
-        return is_resp;
+        return IsConnected() && std::chrono::steady_clock::now() < (response_check_delay + last_received_time.load());
     }
 
 
@@ -344,11 +391,10 @@ private:
 
 
     static constexpr auto response_check_delay = std::chrono::milliseconds(1000);
-    std::chrono::steady_clock::time_point last_received_time;
-    bool is_responding = false;
+    std::atomic<std::chrono::steady_clock::time_point> last_received_time;
 
 
-    boost::json::stream_parser json_parser;
+    JsonFrameReader frame_reader;
 
 public:
     struct FileWriteResponse{
@@ -358,6 +404,15 @@ public:
         std::string msg;
     };
 
+    // response to FILE_BEGIN, FILE_CHUNK and FILE_END
+    struct FileTransferResponse{
+        FileTransferResponse():result(Result::_ERR), offset(0){};
+
+        enum class Result{_OK, _ERR} result;
+        std::string msg;
+        uint64_t offset;    // bytes of file already stored by PLC
+    };
+
     struct AppBuildResponse{
         AppBuildResponse():result(Result::_ERR){};
 
@@ -393,103 +448,129 @@ public:
         enum class Status{_UNNOWN,_STOPPED, _RUNNING} status;
     };
 
-private:
-    std::mutex response_mutex;
-    bool filewrite_response_received = false;
-    FileWriteResponse filewrite_response;
+    struct CapabilitiesResponse{
+        CapabilitiesResponse():result(Result::_ERR){};
 
-    bool appbuild_response_received = false;
-    AppBuildResponse appbuild_response;
+        enum class Result{_OK, _ERR} result;
+        std::vector<std::string> compression;   // encodings of file data PLC accepts, e.g. "deflate"
+    };
 
-    bool appstart_response_received = false;
-    AppStartResponse appstart_response;
+    // Requests
+    //
+    // Every request gets "Id" which PLC copies to its response, so any number of requests of any
+    // type can wait at once (e.g. pipelined file chunks). Response without "Id" (older PLC runtime)
+    // belongs to the oldest waiting request with the same "Cmd", runtimes answer in order.
+    // Reply gets std::nullopt when connection is lost before response.
+    //
+    template<typename Response>
+    using Reply = std::future<std::optional<Response>>;
 
-    bool appstop_response_received = false;
-    AppStopResponse appstop_response;
+private:
+    struct PendingRequest{
+        std::string cmd;
+        std::chrono::steady_clock::time_point sent;
+        std::function<void(const boost::json::object*)> resolve;    // nullptr - no response
+    };
 
-    bool appstatus_response_received = false;
-    AppStatusResponse appstatus_response;
+    static constexpr auto request_expiry = std::chrono::minutes(5);  // longer than any waiter waits
 
-public:
+    std::mutex pending_mutex;
+    uint64_t next_request_id = 1;
+    std::map<uint64_t, PendingRequest> pending_requests;
 
 
-    bool GetIfFileWriteResponse(FileWriteResponse* response){
-        std::scoped_lock(response_mutex);
+    // 'payload' is sent right after request line
+    template<typename Response>
+    Reply<Response> Request(boost::json::object& msg, Response (*parse)(const boost::json::object&), const uint8_t* payload = nullptr, size_t payload_size = 0){
+        auto promise = std::make_shared<std::promise<std::optional<Response>>>();
+        Reply<Response> reply = promise->get_future();
 
-        if(filewrite_response_received){
-            *response = filewrite_response;
+        if(!IsConnected()){
+            promise->set_value(std::nullopt);
+            return reply;
         }
-        return filewrite_response_received;
-    }
 
-    
-    bool GetIfCompileCodeeResponse(AppBuildResponse* response){
-        std::scoped_lock(response_mutex);
+        std::string cmd;
+        if(auto cmd_str = msg["Cmd"].if_string()) cmd = cmd_str->c_str();
 
-        if(appbuild_response_received){
-            *response = appbuild_response;
+        std::vector<PendingRequest> expired;
+        {
+            std::scoped_lock lock(pending_mutex);
+            const auto now = std::chrono::steady_clock::now();
+
+            for(auto iter = pending_requests.begin(); iter != pending_requests.end();){
+                if(now - iter->second.sent > request_expiry){
+                    expired.push_back(std::move(iter->second));
+                    iter = pending_requests.erase(iter);
+                }else{
+                    iter++;
+                }
+            }
+
+            msg["Id"] = next_request_id;
+            pending_requests[next_request_id++] = PendingRequest{cmd, now,
+                [promise, parse](const boost::json::object* js){
+                    if(js) promise->set_value(parse(*js));
+                    else promise->set_value(std::nullopt);
+                }};
         }
-        return appbuild_response_received;
-    }
+        for(PendingRequest& request: expired) request.resolve(nullptr);
+
+        std::string msg_str = boost::json::serialize(msg) + "\n";
 
-    bool GetIfAppStartResponse(AppStartResponse* response){
-        std::scoped_lock(response_mutex);
+        if(payload){
+            std::vector<uint8_t> frame(msg_str.size() + payload_size);
+            memcpy(frame.data(), msg_str.c_str(), msg_str.size());
+            memcpy(frame.data() + msg_str.size(), payload, payload_size);
+            Write(std::move(frame));
 
-        if(appstart_response_received){
-            *response = appstart_response;
+            RX_TX_messages_mutex.lock();
+            TX_messages.emplace(msg_str);
+            RX_TX_messages_mutex.unlock();
+        }else{
+            WriteAndLog(msg_str);
         }
-        return appstart_response_received;
+
+        return reply;
     }
 
-    bool GetIfAppStopResponse(AppStopResponse* response){
-        std::scoped_lock(response_mutex);
 
-        if(appstop_response_received){
-            *response = appstop_response;
+    // gives response to its request, by "Id" or by "Cmd" of the oldest request
+    void ResolveRequest(const boost::json::object& js, const std::string& cmd){
+        std::function<void(const boost::json::object*)> resolve;
+        {
+            std::scoped_lock lock(pending_mutex);
+
+            auto iter = pending_requests.end();
+            if(auto id_js = js.if_contains("Id")){
+                if(auto id_u64 = id_js->if_uint64()) iter = pending_requests.find(*id_u64);
+                else if(auto id_i64 = id_js->if_int64()) iter = pending_requests.find((uint64_t)*id_i64);
+            }else{
+                iter = std::find_if(pending_requests.begin(), pending_requests.end(), [&](const auto& request){ return request.second.cmd == cmd; });
+            }
+
+            if(iter == pending_requests.end()) return; // e.g. PING, or request which already expired
+            resolve = std::move(iter->second.resolve);
+            pending_requests.erase(iter);
         }
-        return appstop_response_received;
+        resolve(&js);
     }
 
-    bool GetIfAppStatusResponse(AppStatusResponse* response){
-        std::scoped_lock(response_mutex);
 
-        if(appstatus_response_received){
-            *response = appstatus_response;
+    // connection lost, no response will come
+    void FailRequests(){
+        std::map<uint64_t, PendingRequest> failed;
+        {
+            std::scoped_lock lock(pending_mutex);
+            failed.swap(pending_requests);
         }
-        return appstatus_response_received;
+        for(auto& [id, request]: failed) request.resolve(nullptr);
     }
 
 
 private:
     
 
-	void parseJsonStream( const char * const data, size_t len) {
-		boost::json::value json;
-
-		std::error_code err;
-		size_t start = 0;
-		for (size_t i = 0; i < len; i++) {
-			if (data[i] == '\n') {
-				json_parser.write(&data[start], i - start, err);
-				json_parser.finish(err);
-
-				if (json_parser.done()) {
-					auto json = json_parser.release();
-					//DataFrame data = boost::json::value_to<DataFrame>(json);
-					onReadCommand(json);
-				}
-				else {
-					onReadCommand(err);
-				}
-				json_parser.reset();
-				start = i;
-			}
-		}
-		json_parser.write(&data[start], len - start, err);
-	}
-
-
-
     virtual void onConnecting(){
         event_queue_mutex.lock();
         event_queue.emplace(EventType::CONNECTING);
@@ -498,6 +579,10 @@ private:
 
 
     virtual void onConnected(const boost::system::error_code& error) {
+        frame_reader.Reset();
+
+        if(error) FailRequests();
+
         event_queue_mutex.lock();
         if(error) event_queue.emplace(EventType::CONNECTION_FAILED, error);
         else event_queue.emplace(EventType::CONNECTED, error);
@@ -506,6 +591,8 @@ private:
 
 
     virtual void onDisconnected(const boost::system::error_code& error) {
+        FailRequests();
+
         event_queue_mutex.lock();
         if(error) event_queue.emplace(EventType::CONNECTION_LOST, error);
         else event_queue.emplace(EventType::DISCONNECTED, error);
@@ -517,15 +604,22 @@ private:
     virtual void onRead(const boost::system::error_code& error, size_t bytes_received, const uint8_t * const data) {
         if(error) return;
         
-        parseJsonStream((const char * const)data, bytes_received);
+        frame_reader.Feed(
+            (const char*)data, bytes_received,
+            [this](const boost::json::value& js){ onReadCommand(js); },
+            [this](JsonFrameReader::Error err){ onReadCommand(err); }
+        );
     }
 
-    void onReadCommand(std::error_code err){
-
+    void onReadCommand(JsonFrameReader::Error err){
+        event_queue_mutex.lock();
+        if(err == JsonFrameReader::Error::FRAME_TOO_LARGE) event_queue.emplace(EventType::MESSAGE_TOO_LARGE);
+        else event_queue.emplace(EventType::INVALID_MESSAGE);
+        event_queue_mutex.unlock();
     }
 
     void onReadCommand(const boost::json::value& js){
-        last_received_time = std::chrono::high_resolution_clock::now();
+        last_received_time = std::chrono::steady_clock::now();
 
         // std::cout << "Received :: " << js << "\n";
         if(auto obj_js = js.if_object()){
@@ -536,12 +630,7 @@ private:
 
                     std::string cmd = cmd_str_js->c_str();
                     
-                    if(cmd == "PING") onReadCommandResponsePing();
-                    else if(cmd == "FILE_WRITE") onReadCommandResponseFileWrite(*obj_js);
-                    else if(cmd == "APP_BUILD") onReadCommandResponseAppBuild(*obj_js);
-                    else if(cmd == "APP_START") onReadCommandResponseAppStart(*obj_js);
-                    else if(cmd == "APP_STOP") onReadCommandResponseAppStop(*obj_js);
-                    else if(cmd == "APP_STATUS") onReadCommandResponseAppStatus(*obj_js);
+                    ResolveRequest(*obj_js, cmd);
                 }
             }
         }
@@ -553,11 +642,7 @@ private:
         RX_TX_messages_mutex.unlock();
     }
 
-    void onReadCommandResponsePing(){
-
-    }
-
-    void onReadCommandResponseFileWrite(const boost::json::object& js){
+    static FileWriteResponse ParseFileWrite(const boost::json::object& js){
         FileWriteResponse response;
 
         if(auto result_js = js.if_contains("Result")){
@@ -573,14 +658,34 @@ private:
             }
         }
 
-        {
-            std::scoped_lock lock(response_mutex);
-            filewrite_response_received = true;
-            filewrite_response = response;
+        return response;
+    }
+
+    static FileTransferResponse ParseFileTransfer(const boost::json::object& js){
+        FileTransferResponse response;
+
+        if(auto result_js = js.if_contains("Result")){
+            if(auto result_str = result_js->if_string()){
+                if(*result_str == "OK") response.result = FileTransferResponse::Result::_OK;
+                else response.result = FileTransferResponse::Result::_ERR;
+            }
         }
+
+        if(auto msg_js = js.if_contains("Msg")){
+            if(auto msg_str = msg_js->if_string()){
+                response.msg = msg_str->c_str();
+            }
+        }
+
+        if(auto offset_js = js.if_contains("Offset")){
+            if(auto offset_u64 = offset_js->if_uint64()) response.offset = *offset_u64;
+            else if(auto offset_i64 = offset_js->if_int64()) response.offset = *offset_i64 > 0 ? *offset_i64 : 0;
+        }
+
+        return response;
     }
 
-    void onReadCommandResponseAppBuild(const boost::json::object& js){
+    static AppBuildResponse ParseAppBuild(const boost::json::object& js){
         AppBuildResponse response;
 
         if(auto result_js = js.if_contains("Result")){
@@ -618,14 +723,10 @@ private:
             }
         }
 
-        {
-            std::scoped_lock lock(response_mutex);
-            appbuild_response_received = true;
-            appbuild_response = response;
-        }
+        return response;
     }
 
-    void onReadCommandResponseAppStart(const boost::json::object& js){
+    static AppStartResponse ParseAppStart(const boost::json::object& js){
         AppStartResponse response;
 
         if(auto result_js = js.if_contains("Result")){
@@ -641,14 +742,10 @@ private:
             }
         }
 
-        {
-            std::scoped_lock lock(response_mutex);
-            appstart_response_received = true;
-            appstart_response = response;
-        }
+        return response;
     }
 
-    void onReadCommandResponseAppStop(const boost::json::object& js){
+    static AppStopResponse ParseAppStop(const boost::json::object& js){
         AppStopResponse response;
 
         if(auto result_js = js.if_contains("Result")){
@@ -664,14 +761,32 @@ private:
             }
         }
 
-        {
-            std::scoped_lock lock(response_mutex);
-            appstop_response_received = true;
-            appstop_response = response;
+        return response;
+    }
+
+    static CapabilitiesResponse ParseCapabilities(const boost::json::object& js){
+        CapabilitiesResponse response;
+
+        if(auto result_js = js.if_contains("Result")){
+            if(auto result_str = result_js->if_string()){
+                if(*result_str == "OK") response.result = CapabilitiesResponse::Result::_OK;
+                else response.result = CapabilitiesResponse::Result::_ERR;
+            }
+        }
+
+        if(auto compression_js = js.if_contains("Compression")){
+            if(auto compression_arr_js = compression_js->if_array()){
+                for(auto& encoding_js: *compression_arr_js){
+                    if(auto encoding_str = encoding_js.if_string())
+                        response.compression.emplace_back(encoding_str->c_str());
+                }
+            }
         }
+
+        return response;
     }
 
-    void onReadCommandResponseAppStatus(const boost::json::object& js){
+    static AppStatusResponse ParseAppStatus(const boost::json::object& js){
         AppStatusResponse response;
 
         if(auto result_js = js.if_contains("Result")){
@@ -689,11 +804,7 @@ private:
             }
         }
 
-        {
-            std::scoped_lock lock(response_mutex);
-            appstatus_response_received = true;
-            appstatus_response = response;
-        }
+        return response;
     }
 
 
@@ -705,20 +816,6 @@ private:
     }
 
 
-    int i=0;
-
-    virtual void onLoop() {
-        if(!IsConnected()) return;
-
-        is_responding = std::chrono::high_resolution_clock::now() < (response_check_delay + last_received_time);
-
-        // if((i--) == 0){
-        //     i = 200;
-
-        //     SendPing();
-        // }
-    }
-
     void WriteAndLog(const std::string& msg_str){
         Write((const uint8_t *) msg_str.c_str(), msg_str.size());
         RX_TX_messages_mutex.lock();
@@ -762,38 +859,58 @@ private:
 public:
 
 
-    void AppStart(){
+    Reply<AppStartResponse> AppStart(){
         boost::json::object msg;
         msg["Cmd"] = "APP_START";
 
-        std::string msg_str = boost::json::serialize(msg) + "\n";
-
-        {
-            std::scoped_lock lock(response_mutex);
-            appstart_response_received = false;
-        }
-
-        WriteAndLog(msg_str);        
+        return Request(msg, ParseAppStart);
     }
 
 
-    void AppStop(){
+    Reply<AppStopResponse> AppStop(){
         boost::json::object msg;
         msg["Cmd"] = "APP_STOP";
 
-        std::string msg_str = boost::json::serialize(msg) + "\n";
+        return Request(msg, ParseAppStop);
+    }
+
 
-        {
-            std::scoped_lock lock(response_mutex);
-            appstop_response_received = false;
-        }
 
-        WriteAndLog(msg_str);        
+    // Compression of file data
+    //
+    //   CAPABILITIES {"Compression": offered encodings} - PLC answers with "Compression" encodings
+    //                it accepts, PLC which doesn't answer gets plain data
+    //
+    // FILE_WRITE and FILE_BEGIN with "Compression" carry compressed data and "OriginalSize",
+    // "Size" and "Checksum" of FILE_BEGIN/FILE_END are of compressed data. "deflate" is zlib
+    // stream (RFC 1950).
+    //
+    static constexpr const char* compression_deflate = "deflate";
+
+
+    Reply<CapabilitiesResponse> Capabilities(){
+        boost::json::object msg;
+        msg["Cmd"] = "CAPABILITIES";
+        msg["Compression"] = boost::json::array{compression_deflate};
+
+        return Request(msg, ParseCapabilities);
     }
 
 
+    static std::string Deflate(const std::string& data){
+        std::string result;
+        {
+            boost::iostreams::filtering_ostream out;
+            out.push(boost::iostreams::zlib_compressor(boost::iostreams::zlib::best_compression));
+            out.push(boost::iostreams::back_inserter(result));
+            out.write(data.data(), data.size());
+        } // compressor is flushed when stream is destroyed
+        return result;
+    }
 
-    void FileWriteStr(const std::string& str, std::string file_name ){
+
+    // 'compression' - encoding of 'str', original data has 'original_size' bytes
+    Reply<FileWriteResponse> FileWriteStr(const std::string& str, std::string file_name, const std::string& compression = "", uint64_t original_size = 0){
         
         std::string file_hex;
         DataToHexStr((const uint8_t*)str.c_str(), str.size(), &file_hex);
@@ -802,45 +919,95 @@ public:
         msg["Cmd"] = "FILE_WRITE";
         msg["FileName"] = file_name;
         msg["Data"] = file_hex;
+        if(!compression.empty()){
+            msg["Compression"] = compression;
+            msg["OriginalSize"] = original_size;
+        }
 
-        std::string msg_str = boost::json::serialize(msg) + "\n";
-     
-        // Write((const uint8_t*)msg_str.c_str(), msg_str.size());
-        {
-            std::scoped_lock lock(response_mutex);
-            filewrite_response_received = false;
+        return Request(msg, ParseFileWrite);
+    }
+
+
+    // Binary file transfer
+    //
+    //   FILE_BEGIN {"FileName", "Size", "Checksum"} - PLC answers with "Offset" of data it already has
+    //              from interrupted upload of the same file (same name, size and checksum), or 0
+    //   FILE_CHUNK {"Offset", "Size"} line followed by "Size" raw bytes - PLC answers with "Offset"
+    //              of stored data, "ERR" with expected "Offset" when chunk doesn't continue it
+    //              (every chunk is answered, also chunks sent after the wrong one)
+    //   FILE_END   {"FileName", "Checksum"} - PLC checks CRC-32 of whole file and writes it
+    //
+    static constexpr size_t file_chunk_size = 16 * 1024;
+
+
+    // CRC-32 (IEEE 802.3), 'crc' of previous part continues checksum
+    static uint32_t Crc32(const uint8_t* data, size_t len, uint32_t crc = 0){
+        static const std::array<uint32_t, 256> table = [](){
+            std::array<uint32_t, 256> t;
+            for(uint32_t i = 0; i < 256; i++){
+                uint32_t c = i;
+                for(int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                t[i] = c;
+            }
+            return t;
+        }();
+
+        crc = ~crc;
+        for(size_t i = 0; i < len; i++)
+            crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+        return ~crc;
+    }
+
+
+    Reply<FileTransferResponse> FileBegin(const std::string& file_name, uint64_t size, uint32_t checksum, const std::string& compression = "", uint64_t original_size = 0){
+        boost::json::object msg;
+        msg["Cmd"] = "FILE_BEGIN";
+        msg["FileName"] = file_name;
+        msg["Size"] = size;
+        msg["Checksum"] = checksum;
+        if(!compression.empty()){
+            msg["Compression"] = compression;
+            msg["OriginalSize"] = original_size;
         }
-        WriteAndLog(msg_str);
+
+        return Request(msg, ParseFileTransfer);
     }
 
 
-    void CompileCode(){
+    // header line and data are sent as one frame, only header is logged
+    Reply<FileTransferResponse> FileChunk(uint64_t offset, const uint8_t* data, size_t len){
         boost::json::object msg;
-        msg["Cmd"] = "APP_BUILD";
+        msg["Cmd"] = "FILE_CHUNK";
+        msg["Offset"] = offset;
+        msg["Size"] = len;
 
-        std::string msg_str = boost::json::serialize(msg) + "\n";
+        return Request(msg, ParseFileTransfer, data, len);
+    }
 
-        {
-            std::scoped_lock lock(response_mutex);
-            appbuild_response_received = false;
-        }
 
-        WriteAndLog(msg_str);
+    Reply<FileTransferResponse> FileEnd(const std::string& file_name, uint32_t checksum){
+        boost::json::object msg;
+        msg["Cmd"] = "FILE_END";
+        msg["FileName"] = file_name;
+        msg["Checksum"] = checksum;
+
+        return Request(msg, ParseFileTransfer);
     }
 
 
-    void CheckAppStatus(){
+    Reply<AppBuildResponse> CompileCode(){
         boost::json::object msg;
-        msg["Cmd"] = "APP_STATUS";
+        msg["Cmd"] = "APP_BUILD";
 
-        std::string msg_str = boost::json::serialize(msg) + "\n";
+        return Request(msg, ParseAppBuild);
+    }
 
-        {
-            std::scoped_lock lock(response_mutex);
-            appbuild_response_received = false;
-        }
 
-        WriteAndLog(msg_str);
+    Reply<AppStatusResponse> CheckAppStatus(){
+        boost::json::object msg;
+        msg["Cmd"] = "APP_STATUS";
+
+        return Request(msg, ParseAppStatus);
     }
 
 
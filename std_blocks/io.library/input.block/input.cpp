@@ -19,8 +19,8 @@ public:
 
     void update(){
 //////****** begin update ******//////
-		PLC::IOmoduleData data  = PLC::GetIO();
-		output0 = data.input & (1<<parameter0);
+		// inputs are read once per cycle into process image
+		output0 = process_image.io.input & (1<<parameter0);
 //////****** end update ******//////
     }
 };
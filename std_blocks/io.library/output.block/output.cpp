@@ -21,22 +21,22 @@ public:
     void update(){
 //////****** begin update ******//////
 
-		PLC::IOmoduleData data = PLC::GetIO();
+		// outputs are written once per cycle from process image
+		auto& out = process_image.io.output;
 
 		// change output only if block is connected
 		if(input0){
 
-			if(*input0){
-				data.output |= (1<<parameter0);
-			}else{
-				data.output &= ~(1<<parameter0);
+			auto value = *input0 ? (out | (1<<parameter0)) : (out & ~(1<<parameter0));
+
+			if(value != out){
+				out = value;
+				process_image.outputs_changed = true;
 			}
 
 		}
 
-		output0 = (data.output & (1<<parameter0)) != 0;
-
-		PLC::SetIO(data);
+		output0 = (out & (1<<parameter0)) != 0;
 //////****** end update ******//////
     }
 };
@@ -1,17 +1,5 @@
 
 //////****** begin includes ******//////
-#include <map>
-
-
-#ifndef PLC_LOCAL_MEMORY_OBJECT
-#define PLC_LOCAL_MEMORY_OBJECT
-
-std::map<int64_t, bool> plc_local_memory_object;
-
-#endif
-
-
-
 
 //////****** end includes ******//////
 class mem_read_block{ 
@@ -20,26 +8,20 @@ public:
     bool  output0;
 
 //////****** begin functions ******//////
-
+	// slot in memory array generated for addresses used by schematic
+	const bool* value;
 //////****** end functions ******//////
 
     void init(){
 //////****** begin init ******//////
-
+		value = &plc_memory.bool_values[PLC_Memory::BoolSlot(parameter0)];
 //////****** end init ******//////
     }
 
     void update(){
 //////****** begin update ******//////
-		auto iter = plc_local_memory_object.find(parameter0);
-
-		if(iter != plc_local_memory_object.end()){
-			// return memory value
-			output0 = iter->second;
-		}else{
-			// if memory not assigned return false
-			output0 = false;
-		}
+		// memory never written returns zero
+		output0 = *value;
 //////****** end update ******//////
     }
 };
@@ -0,0 +1,27 @@
+
+//////****** begin includes ******//////
+
+//////****** end includes ******//////
+class mem_read_int_block{ 
+public: 
+    int64_t  parameter0;
+    int64_t  output0;
+
+//////****** begin functions ******//////
+	// slot in memory array generated for addresses used by schematic
+	const int64_t* value;
+//////****** end functions ******//////
+
+    void init(){
+//////****** begin init ******//////
+		value = &plc_memory.int_values[PLC_Memory::IntSlot(parameter0)];
+//////****** end init ******//////
+    }
+
+    void update(){
+//////****** begin update ******//////
+		// memory never written returns zero
+		output0 = *value;
+//////****** end update ******//////
+    }
+};
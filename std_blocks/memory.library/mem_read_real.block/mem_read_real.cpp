@@ -0,0 +1,27 @@
+
+//////****** begin includes ******//////
+
+//////****** end includes ******//////
+class mem_read_real_block{ 
+public: 
+    int64_t  parameter0;
+    double  output0;
+
+//////****** begin functions ******//////
+	// slot in memory array generated for addresses used by schematic
+	const double* value;
+//////****** end functions ******//////
+
+    void init(){
+//////****** begin init ******//////
+		value = &plc_memory.real_values[PLC_Memory::RealSlot(parameter0)];
+//////****** end init ******//////
+    }
+
+    void update(){
+//////****** begin update ******//////
+		// memory never written returns zero
+		output0 = *value;
+//////****** end update ******//////
+    }
+};
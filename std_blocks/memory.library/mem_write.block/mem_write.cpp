@@ -1,15 +1,5 @@
 
 //////****** begin includes ******//////
-#include <map>
-
-
-#ifndef PLC_LOCAL_MEMORY_OBJECT
-#define PLC_LOCAL_MEMORY_OBJECT
-
-std::map<int64_t, bool> plc_local_memory_object;
-
-#endif
-
 
 //////****** end includes ******//////
 class mem_write_block{ 
@@ -18,19 +8,20 @@ public:
     int64_t  parameter0;
 
 //////****** begin functions ******//////
-
+	// slot in memory array generated for addresses used by schematic
+	bool* value;
 //////****** end functions ******//////
 
     void init(){
 //////****** begin init ******//////
-
+		value = &plc_memory.bool_values[PLC_Memory::BoolSlot(parameter0)];
 //////****** end init ******//////
     }
 
     void update(){
 //////****** begin update ******//////
 		if(input0)
-			plc_local_memory_object[parameter0] = *input0;
+			*value = *input0;
 //////****** end update ******//////
     }
 };
@@ -0,0 +1,27 @@
+
+//////****** begin includes ******//////
+
+//////****** end includes ******//////
+class mem_write_int_block{ 
+public: 
+    const int64_t* input0;
+    int64_t  parameter0;
+
+//////****** begin functions ******//////
+	// slot in memory array generated for addresses used by schematic
+	int64_t* value;
+//////****** end functions ******//////
+
+    void init(){
+//////****** begin init ******//////
+		value = &plc_memory.int_values[PLC_Memory::IntSlot(parameter0)];
+//////****** end init ******//////
+    }
+
+    void update(){
+//////****** begin update ******//////
+		if(input0)
+			*value = *input0;
+//////****** end update ******//////
+    }
+};
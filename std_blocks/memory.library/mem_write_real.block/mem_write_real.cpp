@@ -0,0 +1,27 @@
+
+//////****** begin includes ******//////
+
+//////****** end includes ******//////
+class mem_write_real_block{ 
+public: 
+    const double* input0;
+    int64_t  parameter0;
+
+//////****** begin functions ******//////
+	// slot in memory array generated for addresses used by schematic
+	double* value;
+//////****** end functions ******//////
+
+    void init(){
+//////****** begin init ******//////
+		value = &plc_memory.real_values[PLC_Memory::RealSlot(parameter0)];
+//////****** end init ******//////
+    }
+
+    void update(){
+//////****** begin update ******//////
+		if(input0)
+			*value = *input0;
+//////****** end update ******//////
+    }
+};
@@ -1,7 +1,5 @@
 
 //////****** begin includes ******//////
-#include <chrono>
-#include <iostream>
 
 //////****** end includes ******//////
 class clock_block{ 
@@ -14,18 +12,17 @@ public:
 
 //////****** begin functions ******//////
 	
-    std::chrono::milliseconds period;
-    std::chrono::milliseconds half;
-	std::chrono::high_resolution_clock::time_point past;
+	// time comes from process image, the same timestamp for whole cycle
+	int64_t past;
+	PLC_Timer tick_timer;
+	PLC_Timer half_timer;
 
 	bool enabled_old = false;
 //////****** end functions ******//////
 
     void init(){
 //////****** begin init ******//////
-		period = std::chrono::milliseconds(parameter1 * 1000);
-		half = std::chrono::milliseconds(parameter1 * 1000/2);
-		past = std::chrono::high_resolution_clock::now();
+		past = process_image.time_ms;
 //////****** end init ******//////
     }
 
@@ -37,37 +34,39 @@ public:
 		bool en_p = parameter0;
 		bool en = en_i || en_p;
 		
-		// check if block is enabled. if not return immediately
+		// check if block is enabled. if not stop timers and return immediately
 		if(!en){
+			if(enabled_old){
+				process_image.timers.Stop(tick_timer);
+				process_image.timers.Stop(half_timer);
+			}
 			enabled_old = false;
 			output0 = false;
 			output1 = false;
 			return;
 		}
 
-		std::chrono::high_resolution_clock::time_point now = std::chrono::high_resolution_clock::now();
+		const int64_t period = parameter1 * 1000;
 
 		// check if timer has been enabled
-		if(!enabled_old && en){
+		if(!enabled_old){
 			enabled_old = true;
-			past = now;
+			past = process_image.time_ms;
+			process_image.timers.StartAt(tick_timer, past + period);
+			process_image.timers.StartAt(half_timer, past + period / 2);
 		}
 
 		output0 = false;
+		output1 = !half_timer.expired;
 
-		if(now < past + half){
-			output1 = true;
-		}else{
-			output1 = false;
-		}
-
-		if(now >= past + period){
+		// next period is counted from end of previous one, not from current cycle
+		if(tick_timer.expired){
 			output0 = true;
 			output1 = true;
 			past = past + period;
+			process_image.timers.StartAt(tick_timer, past + period);
+			process_image.timers.StartAt(half_timer, past + period / 2);
 		}
-
-		std::cout << (now-past+period) / std::chrono::milliseconds(1) << " \t " << (now-past) / std::chrono::milliseconds(1) <<"\n";
 //////****** end update ******//////
     }
 };
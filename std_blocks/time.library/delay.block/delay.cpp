@@ -1,7 +1,5 @@
 
 //////****** begin includes ******//////
-#include <chrono>
-
 
 //////****** end includes ******//////
 class delay_block{ 
@@ -15,7 +13,8 @@ public:
     bool  output0;
 
 //////****** begin functions ******//////
-	std::chrono::high_resolution_clock::time_point past;
+	// started on every edge of input, time comes from process image
+	PLC_Timer timer;
 	
 	bool previous_in;
 
@@ -23,7 +22,9 @@ public:
 
     void init(){
 //////****** begin init ******//////
-
+		previous_in = false;
+		output0 = false;
+		timer.expired = true; // no edge yet - input is passed like after long delay
 //////****** end init ******//////
     }
 
@@ -37,30 +38,16 @@ public:
 		
 		bool in = input1 ? (*input1) : false;
 
-		std::chrono::high_resolution_clock::time_point now = std::chrono::high_resolution_clock::now();
-		std::chrono::seconds delay = std::chrono::seconds(0);
-
 		// detect edge 
-		if(previous_in != *input1){
-
-			previous_in = *input1;
-			past = now;
-
-			delay = std::chrono::seconds(0);
+		if(previous_in != in){
+			previous_in = in;
+			process_image.timers.Start(timer, parameter1 * 1000);
 		}
 
+		// rising / falling edge is delayed only when enabled
+		bool delayed = en && ((in && parameter2) || (!in && parameter3));
 
-		// rising edge
-		if(in && parameter2 && en){
-			delay = std::chrono::seconds(parameter1);
-		}
-
-		// falling edge
-		if(!in && parameter3 && en){
-			delay = std::chrono::seconds(parameter1);
-		}
-
-		if(now > past + delay){
+		if(!delayed || timer.expired){
 			output0 = in;
 		}
 		